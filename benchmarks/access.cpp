@@ -0,0 +1,463 @@
+//
+// Benchmark of smart_mutex access paths under contention for different Mutex policies.
+//
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "adaptive_mutex.hpp"
+#include "channel.hpp"
+#include "combining_mutex.hpp"
+#include "elided_mutex.hpp"
+#include "hold_budget_mutex.hpp"
+#include "numa_cohort_mutex.hpp"
+#include "parallel_visit.hpp"
+#if !defined(_WIN32)
+#include "pi_mutex.hpp"
+#endif
+#include "pmr_smart_mutex.hpp"
+#include "profiled_mutex.hpp"
+#include "smart_mutex.hpp"
+#include "upgrade_mutex.hpp"
+
+namespace
+{
+
+struct Payload
+{
+    std::uint64_t values[8] = {};
+
+    bool operator==(const Payload &other) const { return std::equal(values, values + 8, other.values); }
+    bool operator!=(const Payload &other) const { return !(*this == other); }
+};
+
+// Cheap per-thread pseudo random generator for the read/write mix.
+struct xorshift
+{
+    explicit xorshift(std::uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {
+    }
+
+    std::uint64_t operator()() noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    std::uint64_t state;
+};
+
+// Samples latency of every 64th operation and reports percentiles as counters.
+class latency_sampler
+{
+    static constexpr std::uint64_t period = 64;
+
+  public:
+    template<typename Fn>
+    void run(Fn &&fn) {
+        if (++count % period) {
+            fn();
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void report(benchmark::State &state) {
+        if (samples.empty())
+            return;
+        std::sort(samples.begin(), samples.end());
+        const auto percentile = [this](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * static_cast<double>(samples.size())))];
+        };
+        state.counters["p50_ns"] = benchmark::Counter(percentile(0.50), benchmark::Counter::kAvgThreads);
+        state.counters["p99_ns"] = benchmark::Counter(percentile(0.99), benchmark::Counter::kAvgThreads);
+        state.counters["p999_ns"] = benchmark::Counter(percentile(0.999), benchmark::Counter::kAvgThreads);
+    }
+
+  private:
+    std::uint64_t count = 0;
+    std::vector<double> samples;
+};
+
+template<class Mutex>
+using smart_payload = im::smart_mutex<Payload, Mutex>;
+
+template<class Mutex>
+using versioned_payload = im::versioned_smart_mutex<Payload, Mutex>;
+
+// operator->() for writes and operator->() const for reads, range(0) is the percent of writes.
+template<class Mutex>
+void BM_AccessMix(benchmark::State &state) {
+    static smart_payload<Mutex> shared;
+    const auto writes = static_cast<std::uint64_t>(state.range(0));
+    xorshift random(static_cast<std::uint64_t>(state.thread_index()));
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            if (random() % 100 < writes)
+                ++shared->values[0];
+            else
+                benchmark::DoNotOptimize(std::as_const(shared)->values[0]);
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Copy out through operator T().
+template<class Mutex>
+void BM_CopyOut(benchmark::State &state) {
+    static smart_payload<Mutex> shared;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            Payload copy = shared;
+            benchmark::DoNotOptimize(copy);
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Comparison with the value of underlying type.
+template<class Mutex>
+void BM_CompareValue(benchmark::State &state) {
+    static smart_payload<Mutex> shared;
+    const Payload expected;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] { benchmark::DoNotOptimize(shared == expected); });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Comparison of two smart_mutexes, both are locked.
+template<class Mutex>
+void BM_CompareSmart(benchmark::State &state) {
+    static smart_payload<Mutex> lhs, rhs;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] { benchmark::DoNotOptimize(lhs == rhs); });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Swap of two smart_mutexes, both are locked.
+template<class Mutex>
+void BM_Swap(benchmark::State &state) {
+    static smart_payload<Mutex> lhs, rhs;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] { swap(lhs, rhs); });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Swap of two smart_mutexes with the large value, inline or behind the pointer depending on Layout.
+template<class Layout>
+void BM_SwapLarge(benchmark::State &state) {
+    static im::smart_mutex<std::array<std::uint64_t, 1024>, std::mutex, Layout> lhs, rhs;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] { swap(lhs, rhs); });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Rebuild of the sorted vector computed outside of the lock and committed if nobody wrote meanwhile.
+template<class Layout>
+void BM_Update(benchmark::State &state) {
+    static im::smart_mutex<std::vector<std::uint64_t>, std::shared_mutex, im::layout::versioned<Layout>> shared(std::vector<std::uint64_t>(256));
+    xorshift random(static_cast<std::uint64_t>(state.thread_index()));
+    latency_sampler sampler;
+    for (auto _ : state) {
+        const auto value = random() % 1024;
+        sampler.run([&] {
+            shared.update([value](const std::vector<std::uint64_t> &old) {
+                std::vector<std::uint64_t> sorted(old);
+                sorted.back() = value;
+                std::sort(sorted.begin(), sorted.end());
+                return sorted;
+            });
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Event buffer filled by all threads, the first one drains it into the recycled spare every 64 iterations.
+void BM_TakeAll(benchmark::State &state) {
+    static im::smart_mutex<std::vector<std::uint64_t>> events;
+    std::vector<std::uint64_t> spare;
+    std::uint64_t iteration = 0;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            if (state.thread_index() == 0 && ++iteration % 64 == 0) {
+                std::uint64_t sum = 0;
+                for (auto event : events.take_all(spare))
+                    sum += event;
+                benchmark::DoNotOptimize(sum);
+            } else {
+                events->push_back(iteration);
+            }
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Per-thread statistics updated by their owners, the first thread aggregates all of them
+// every 64 iterations, either locking them in order or skipping the busy ones.
+template<bool SkipBusy>
+void BM_Aggregate(benchmark::State &state) {
+    static std::vector<im::padded_smart_mutex<std::uint64_t>> stats(64);
+    auto &own = stats[static_cast<std::size_t>(state.thread_index()) % stats.size()];
+    std::uint64_t iteration = 0;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            if (state.thread_index() == 0 && ++iteration % 64 == 0) {
+                std::uint64_t sum = 0;
+                const auto add = [&sum](const std::uint64_t &value) { sum += value; };
+                if constexpr (SkipBusy) {
+                    im::parallel_visit(std::as_const(stats), add);
+                } else {
+                    for (const auto &smart : stats)
+                        add(*im::padded_smart_mutex<std::uint64_t>::read_access(smart).operator->());
+                }
+                benchmark::DoNotOptimize(sum);
+            } else {
+                ++*own.operator->().operator->();
+            }
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Hand-off of messages through the mutexed deque, every thread pushes and pops one.
+void BM_HandOffDeque(benchmark::State &state) {
+    static im::smart_mutex<std::deque<std::uint64_t>> queue;
+    std::uint64_t iteration = 0;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            queue->push_back(++iteration);
+            if (auto messages = queue.operator->(); !messages->empty()) {
+                benchmark::DoNotOptimize(messages->front());
+                messages->pop_front();
+            }
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Hand-off of messages through the lock-free channel, every thread pushes and pops one.
+void BM_HandOffChannel(benchmark::State &state) {
+    static im::channel<std::uint64_t, 1024> queue;
+    std::uint64_t iteration = 0;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            queue.try_push(++iteration);
+            benchmark::DoNotOptimize(queue.try_pop());
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Node allocation and release under the lock, from the global heap or the private pool depending on Smart.
+template<class Smart>
+void BM_ListChurn(benchmark::State &state) {
+    static Smart shared;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            typename Smart::write_access list(shared);
+            list->push_back(state.iterations());
+            if (list->size() > 64)
+                list->pop_front();
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Copy construction from the shared smart_mutex.
+template<class Mutex>
+void BM_CopyConstruct(benchmark::State &state) {
+    static smart_payload<Mutex> shared;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            smart_payload<Mutex> copy(shared);
+            benchmark::DoNotOptimize(&copy);
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Counter increment executed by the lock holder on behalf of the caller.
+template<class Mutex>
+void BM_Combine(benchmark::State &state) {
+    static smart_payload<Mutex> shared;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] { shared.combine([](Payload &payload) { ++payload.values[0]; }); });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Read of the rarely changed value through the per-thread replica, 0.1% of iterations write.
+template<class Mutex>
+void BM_CachedRead(benchmark::State &state) {
+    static versioned_payload<Mutex> shared;
+    xorshift random(static_cast<std::uint64_t>(state.thread_index()));
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            if (random() % 1000 == 0)
+                ++shared->values[0];
+            else
+                benchmark::DoNotOptimize(shared.cached_read().values[0]);
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Read only traversal validated by the version instead of locking, 10% of iterations write.
+template<class Mutex>
+void BM_OptimisticRead(benchmark::State &state) {
+    static versioned_payload<Mutex> shared;
+    xorshift random(static_cast<std::uint64_t>(state.thread_index()));
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            if (random() % 10 == 0) {
+                ++shared->values[0];
+            } else {
+                benchmark::DoNotOptimize(shared.optimistic_read([](const Payload &payload) {
+                    std::uint64_t sum = 0;
+                    for (auto value : payload.values)
+                        sum += value;
+                    return sum;
+                }));
+            }
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Comparison of the lock-free atomic value with a constant, 1% of iterations write.
+template<class Mutex>
+void BM_CompareState(benchmark::State &state) {
+    enum class Status { Idle, Ready };
+    static im::smart_mutex<Status, Mutex> shared(Status::Ready);
+    xorshift random(static_cast<std::uint64_t>(state.thread_index()));
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] {
+            if (random() % 100 == 0)
+                *shared.operator->().operator->() = Status::Ready;
+            else
+                benchmark::DoNotOptimize(shared == Status::Ready);
+        });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Writes of every thread to its own bucket of one big table, which could run in parallel only if elided.
+template<class Mutex>
+void BM_DisjointWrite(benchmark::State &state) {
+    struct alignas(64) Bucket
+    {
+        std::uint64_t value = 0;
+    };
+    static im::smart_mutex<std::array<Bucket, 64>, Mutex> shared;
+    const auto bucket = static_cast<std::size_t>(state.thread_index()) % 64;
+    latency_sampler sampler;
+    for (auto _ : state) {
+        sampler.run([&] { ++(*shared.operator->().operator->())[bucket].value; });
+    }
+    sampler.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+
+constexpr int kMaxThreads = 16;
+
+} // end namespace
+
+#define SMART_MUTEX_ACCESS_BENCHMARKS(Mutex)                                                                    \
+    BENCHMARK_TEMPLATE(BM_AccessMix, Mutex)->ArgName("write_pct")->Arg(0)->Arg(10)->Arg(50)->Arg(100)           \
+        ->ThreadRange(1, kMaxThreads)->UseRealTime();                                                           \
+    BENCHMARK_TEMPLATE(BM_CopyOut, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                          \
+    BENCHMARK_TEMPLATE(BM_CompareValue, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                     \
+    BENCHMARK_TEMPLATE(BM_CompareSmart, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                     \
+    BENCHMARK_TEMPLATE(BM_CompareState, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                     \
+    BENCHMARK_TEMPLATE(BM_CachedRead, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                       \
+    BENCHMARK_TEMPLATE(BM_OptimisticRead, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                   \
+    BENCHMARK_TEMPLATE(BM_Swap, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();                             \
+    BENCHMARK_TEMPLATE(BM_CopyConstruct, Mutex)->ThreadRange(1, kMaxThreads)->UseRealTime()
+
+SMART_MUTEX_ACCESS_BENCHMARKS(std::mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(std::shared_mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(std::recursive_mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::adaptive_mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::ticket_mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::profiled_mutex<>);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::hold_budget_mutex<>);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::combining_mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::upgrade_mutex);
+SMART_MUTEX_ACCESS_BENCHMARKS(im::numa_cohort_mutex);
+#if !defined(_WIN32)
+SMART_MUTEX_ACCESS_BENCHMARKS(im::pi_mutex);
+#endif
+
+BENCHMARK_TEMPLATE(BM_SwapLarge, im::layout::packed)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SwapLarge, im::layout::indirect)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_Update, im::layout::packed)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Update, im::layout::indirect)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK(BM_TakeAll)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_Aggregate, false)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Aggregate, true)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK(BM_HandOffDeque)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK(BM_HandOffChannel)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_ListChurn, im::smart_mutex<std::pmr::list<std::uint64_t>>)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ListChurn, im::pmr_smart_mutex<std::pmr::list<std::uint64_t>>)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_DisjointWrite, std::mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DisjointWrite, im::adaptive_mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DisjointWrite, im::elided_mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_Combine, im::combining_mutex)->ThreadRange(1, kMaxThreads)->UseRealTime();
@@ -0,0 +1,79 @@
+//
+// Benchmark of smart_mutex construction from large containers.
+//
+
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "smart_mutex.hpp"
+
+namespace
+{
+
+struct Order
+{
+    long id;
+    double price;
+    double quantity;
+    char symbol[16];
+};
+
+using orders = std::vector<Order>;
+
+// Baseline: only building the temporary.
+void BM_BuildTemporary(benchmark::State &state) {
+    for (auto _ : state) {
+        orders tmp(static_cast<std::size_t>(state.range(0)));
+        benchmark::DoNotOptimize(tmp.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Order));
+}
+
+// The temporary is moved into the wrapper, no deep copy expected.
+void BM_ConstructFromTemporary(benchmark::State &state) {
+    for (auto _ : state) {
+        im::smart_mutex<orders> sm(orders(static_cast<std::size_t>(state.range(0))));
+        benchmark::DoNotOptimize(&sm);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Order));
+}
+
+// The value is constructed directly inside the wrapper.
+void BM_ConstructInPlace(benchmark::State &state) {
+    for (auto _ : state) {
+        im::smart_mutex<orders> sm(std::in_place, static_cast<std::size_t>(state.range(0)));
+        benchmark::DoNotOptimize(&sm);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Order));
+}
+
+// Deep copy of the wrapped value, single allocation expected.
+void BM_CopyConstruct(benchmark::State &state) {
+    im::smart_mutex<orders> source(std::in_place, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        im::smart_mutex<orders> sm(source);
+        benchmark::DoNotOptimize(&sm);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(Order));
+}
+
+// Stealing the buffer of another wrapper.
+void BM_MoveConstruct(benchmark::State &state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        im::smart_mutex<orders> source(std::in_place, static_cast<std::size_t>(state.range(0)));
+        state.ResumeTiming();
+        im::smart_mutex<orders> sm(std::move(source));
+        benchmark::DoNotOptimize(&sm);
+    }
+}
+
+} // end namespace
+
+BENCHMARK(BM_BuildTemporary)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_ConstructFromTemporary)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_ConstructInPlace)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_CopyConstruct)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_MoveConstruct)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
@@ -0,0 +1,36 @@
+//
+// Benchmark of false sharing between adjacent smart_mutex instances.
+//
+
+#include <array>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "smart_mutex.hpp"
+
+namespace
+{
+
+constexpr std::size_t kShards = 64;
+
+// Every thread increments its own shard, so the only contention is false sharing.
+template<class Shard>
+void BM_ShardIncrement(benchmark::State &state) {
+    static std::array<Shard, kShards> shards;
+    auto &shard = shards[static_cast<std::size_t>(state.thread_index()) % kShards];
+    for (auto _ : state) {
+        typename Shard::write_access wa(shard);
+        ++*wa.operator->();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // end namespace
+
+BENCHMARK_TEMPLATE(BM_ShardIncrement, im::smart_mutex<std::uint64_t>)
+    ->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShardIncrement, im::padded_smart_mutex<std::uint64_t>)
+    ->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShardIncrement, im::isolated_smart_mutex<std::uint64_t>)
+    ->ThreadRange(1, 16)->UseRealTime();
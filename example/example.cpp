@@ -3,10 +3,14 @@
 //
 
 #include <iostream>
+#include <map>
 #include <string>
 #include <algorithm>
+#include <shared_mutex>
+#include <utility>
 
 #include "smart_mutex.hpp"
+#include "upgrade_mutex.hpp"
 
 // BasicLockable class
 class XRayMutex : public std::mutex
@@ -104,6 +108,41 @@ int main() {
     }
     std::cout << std::endl;
 
+    // lock several objects at once without deadlock
+    {
+        auto [wa, ra] = im::access_all(smString, std::as_const(smStringCopy));
+        wa->append(ra->c_str());
+        std::cout << "c_str() " << wa->c_str() << "\n";
+    }
+    std::cout << std::endl;
+
+    // non-blocking access, skipped if the lock is busy
+    if (auto sa = smString.try_write())
+        std::cout << "size() " << sa->size() << "\n";
+    std::cout << std::endl;
+
+    // as read only with SharedLockable mutex, readers don't block each other
+    using sm_shared_string = im::smart_mutex<std::string, std::shared_mutex>;
+    sm_shared_string smSharedString("shared");
+    {
+        sm_shared_string::read_access ra1(smSharedString);
+        sm_shared_string::read_access ra2(smSharedString);
+        std::cout << "c_str() " << ra1->c_str() << " " << ra2->c_str() << "\n";
+    }
+    std::cout << std::endl;
+
+    // check under the upgrade lock, readers aren't blocked unless the value is modified
+    using sm_cache = im::smart_mutex<std::map<int, std::string>, im::upgrade_mutex>;
+    sm_cache smCache;
+    for (int key : {1, 2, 1}) {
+        if (auto ua = smCache.upgradeable(); !ua->count(key)) {
+            auto wa = ua.upgrade();
+            wa->emplace(key, std::to_string(key));
+            std::cout << "insert " << key << "\n";
+        }
+    }
+    std::cout << std::endl;
+
     // std::swap check
     using std::swap;
     swap(smString, smStringCopy);
@@ -0,0 +1,179 @@
+// Implementation of the spinning mutex policies for short critical sections.
+//
+
+#ifndef SMARTMUTEX__ADAPTIVE_MUTEX_H_
+#define SMARTMUTEX__ADAPTIVE_MUTEX_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "detail/atomic_wait.hpp"
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @class basic_adaptive_mutex
+ * @brief Spin-then-park mutex. Contended lock spins with exponential
+ * <code>pause</code> backoff for the bounded number of iterations before
+ * falling back to the OS wait, which makes it cheaper than <code>std::mutex</code>
+ * for critical sections of a few dozen nanoseconds. Meets the Lockable requirements.
+ * @tparam Spins The number of spin iterations before parking the thread.
+ */
+template<std::uint32_t Spins = 128>
+class basic_adaptive_mutex
+{
+    // Maximum number of pauses between two lock attempts.
+    static constexpr std::uint32_t max_backoff = 16;
+
+    // Lock states.
+    static constexpr std::uint32_t unlocked = 0;
+    static constexpr std::uint32_t locked = 1;
+    static constexpr std::uint32_t locked_parked = 2;
+
+  public:
+    basic_adaptive_mutex() noexcept = default;
+
+    basic_adaptive_mutex(const basic_adaptive_mutex &) = delete;
+    basic_adaptive_mutex &operator=(const basic_adaptive_mutex &) = delete;
+
+    /**
+     * @brief Lock the mutex, spin and then block if it is not available.
+     */
+    void lock() noexcept {
+        if (!try_lock())
+            lock_contended();
+    }
+
+    /**
+     * @brief Try to lock the mutex without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        std::uint32_t expected = unlocked;
+        return state.compare_exchange_strong(expected, locked, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check if the mutex is locked by anybody, the result may be outdated immediately.
+     * @return true if the mutex is locked.
+     */
+    bool is_locked() const noexcept {
+        return state.load(std::memory_order_relaxed) != unlocked;
+    }
+
+    /**
+     * @brief Unlock the mutex, wake up one parked waiter if any.
+     */
+    void unlock() noexcept {
+        if (state.exchange(unlocked, std::memory_order_release) == locked_parked)
+            detail::atomic_notify_one(state);
+    }
+
+  private:
+    void lock_contended() noexcept {
+        for (std::uint32_t spins = 0, backoff = 1; spins < Spins; spins += backoff) {
+            for (std::uint32_t i = 0; i < backoff; ++i)
+                detail::cpu_relax();
+            if (state.load(std::memory_order_relaxed) == unlocked && try_lock())
+                return;
+            backoff = std::min(backoff * 2, max_backoff);
+        }
+        // Mark the lock as having parked waiters, so unlock() wakes us up.
+        while (state.exchange(locked_parked, std::memory_order_acquire) != unlocked)
+            detail::atomic_wait(state, locked_parked);
+    }
+
+  private:
+    // Member variables
+    // The lock state.
+    std::atomic<std::uint32_t> state = unlocked;
+};
+
+//! Adaptive mutex with the default spin count.
+typedef basic_adaptive_mutex<> adaptive_mutex;
+
+/**
+ * @class basic_ticket_mutex
+ * @brief Fair FIFO mutex. Threads acquire the lock in the order they arrive,
+ * waiters spin proportionally to their queue position and then park.
+ * Meets the Lockable requirements.
+ * @tparam Spins The number of spin iterations before parking the thread.
+ */
+template<std::uint32_t Spins = 128>
+class basic_ticket_mutex
+{
+  public:
+    basic_ticket_mutex() noexcept = default;
+
+    basic_ticket_mutex(const basic_ticket_mutex &) = delete;
+    basic_ticket_mutex &operator=(const basic_ticket_mutex &) = delete;
+
+    /**
+     * @brief Take the ticket and wait for its turn.
+     */
+    void lock() noexcept {
+        const auto ticket = next.fetch_add(1, std::memory_order_relaxed);
+        auto current = serving.load(std::memory_order_acquire);
+        for (std::uint32_t spins = 0; current != ticket; current = serving.load(std::memory_order_acquire)) {
+            if (spins < Spins) {
+                // Waiters further in the queue poll the line less often.
+                const auto distance = std::min<std::uint32_t>(ticket - current, 16);
+                for (std::uint32_t i = 0; i < distance; ++i)
+                    detail::cpu_relax();
+                spins += distance;
+                continue;
+            }
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            if (serving.load(std::memory_order_seq_cst) == current)
+                detail::atomic_wait(serving, current);
+            parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Try to lock the mutex without blocking, succeeds only if nobody waits.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        auto current = serving.load(std::memory_order_acquire);
+        return next.compare_exchange_strong(current, current + 1, std::memory_order_acquire,
+                                            std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check if other threads wait for the lock, called by the owner.
+     * @return true if the next ticket is already taken.
+     */
+    bool has_waiters() const noexcept {
+        return next.load(std::memory_order_relaxed) - serving.load(std::memory_order_relaxed) > 1;
+    }
+
+    /**
+     * @brief Pass the lock to the next ticket.
+     */
+    void unlock() noexcept {
+        serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_seq_cst) != 0)
+            detail::atomic_notify_all(serving);
+    }
+
+  private:
+    // Member variables
+    // The next ticket to be taken.
+    std::atomic<std::uint32_t> next = 0;
+    // The ticket currently owning the lock.
+    std::atomic<std::uint32_t> serving = 0;
+    // The number of parked waiters.
+    std::atomic<std::uint32_t> parked = 0;
+};
+
+//! Ticket mutex with the default spin count.
+typedef basic_ticket_mutex<> ticket_mutex;
+
+} // end namespace im
+
+#endif //SMARTMUTEX__ADAPTIVE_MUTEX_H_
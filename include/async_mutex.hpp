@@ -0,0 +1,199 @@
+// Implementation of the coroutine aware mutex policy.
+//
+
+#ifndef SMARTMUTEX__ASYNC_MUTEX_H_
+#define SMARTMUTEX__ASYNC_MUTEX_H_
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace im
+{
+
+/**
+ * @class async_mutex
+ * @brief Mutex policy which could be acquired by coroutines without blocking the
+ * thread. Awaiting coroutines are suspended onto the intrusive waiter list and the
+ * lock is handed over to them in FIFO order on unlock, resuming them on the releasing
+ * thread or through the supplied executor. Meets the Lockable requirements, blocking
+ * lock() waits in the same queue. Requires C++20.
+ */
+class async_mutex
+{
+    // Lock states, any other value is the pointer to the last queued waiter.
+    static constexpr std::uintptr_t not_locked = 1;
+    static constexpr std::uintptr_t locked_no_waiters = 0;
+
+    // Intrusive node of the waiter list.
+    struct waiter
+    {
+        // Resume the waiter, the ownership of the lock is passed to it.
+        void (*resume)(waiter &) noexcept = nullptr;
+        waiter *next = nullptr;
+    };
+
+    // The waiter blocking the thread. It may return from lock() and go out of scope
+    // as soon as ready is set, so the releasing thread never touches it afterwards
+    // and wakes it up through the handoffs counter of the mutex.
+    struct sync_waiter : waiter
+    {
+        explicit sync_waiter(async_mutex &mutex) noexcept : mutex(mutex) {
+            resume = [](waiter &w) noexcept {
+                auto &self = static_cast<sync_waiter &>(w);
+                auto &owner = self.mutex;
+                self.ready.store(true, std::memory_order_release);
+                owner.handoffs.fetch_add(1, std::memory_order_release);
+                owner.handoffs.notify_all();
+            };
+        }
+
+        async_mutex &mutex;
+        std::atomic<bool> ready{false};
+    };
+
+  public:
+    /**
+     * @class lock_awaiter
+     * @brief Awaitable acquiring the lock, the coroutine owns it after resumption.
+     * @tparam Executor The callable resuming <code>std::coroutine_handle<></code>,
+     * std::nullptr_t to resume inline on the releasing thread.
+     */
+    template<class Executor>
+    struct lock_awaiter : waiter
+    {
+        lock_awaiter(async_mutex &mutex, Executor executor) : mutex(mutex), executor(std::move(executor)) {
+            resume = [](waiter &w) noexcept {
+                auto &self = static_cast<lock_awaiter &>(w);
+                if constexpr (std::is_null_pointer_v<Executor>)
+                    self.handle.resume();
+                else
+                    self.executor(self.handle);
+            };
+        }
+
+        bool await_ready() noexcept { return mutex.try_lock(); }
+
+        bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle = awaiting;
+            return !mutex.enqueue(*this);
+        }
+
+        void await_resume() noexcept {}
+
+      private:
+        async_mutex &mutex;
+        Executor executor;
+        std::coroutine_handle<> handle;
+    };
+
+  public:
+    async_mutex() noexcept = default;
+
+    async_mutex(const async_mutex &) = delete;
+    async_mutex &operator=(const async_mutex &) = delete;
+
+    /**
+     * @brief Lock the mutex, blocking the thread.
+     */
+    void lock() noexcept {
+        sync_waiter w(*this);
+        if (enqueue(w))
+            return;
+        for (;;) {
+            // Read the counter before the check, so the handoff after it is not missed.
+            const auto seen = handoffs.load(std::memory_order_acquire);
+            if (w.ready.load(std::memory_order_acquire))
+                return;
+            handoffs.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    /**
+     * @brief Try to lock the mutex without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        auto expected = not_locked;
+        return state.compare_exchange_strong(expected, locked_no_waiters, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Lock the mutex asynchronously, waiters are resumed on the releasing thread.
+     * @return Awaitable acquiring the lock.
+     */
+    lock_awaiter<std::nullptr_t> lock_async() noexcept {
+        return lock_awaiter<std::nullptr_t>(*this, nullptr);
+    }
+
+    /**
+     * @brief Lock the mutex asynchronously, waiters are resumed through the executor.
+     * @param executor The callable accepting <code>std::coroutine_handle<></code>.
+     * @return Awaitable acquiring the lock.
+     */
+    template<class Executor>
+    lock_awaiter<std::decay_t<Executor>> lock_async(Executor &&executor) {
+        return lock_awaiter<std::decay_t<Executor>>(*this, std::forward<Executor>(executor));
+    }
+
+    /**
+     * @brief Unlock the mutex, pass the ownership to the first waiter if any.
+     */
+    void unlock() noexcept {
+        auto *head = waiters;
+        if (!head) {
+            auto expected = locked_no_waiters;
+            if (state.compare_exchange_strong(expected, not_locked, std::memory_order_release,
+                                              std::memory_order_relaxed))
+                return;
+            // Take all newly queued waiters, they are in LIFO order.
+            auto *queued = reinterpret_cast<waiter *>(state.exchange(locked_no_waiters, std::memory_order_acquire));
+            do {
+                auto *next = queued->next;
+                queued->next = head;
+                head = queued;
+                queued = next;
+            } while (queued);
+        }
+        waiters = head->next;
+        head->resume(*head);
+    }
+
+  private:
+    // Acquire the lock or queue the waiter, return true if the lock was acquired.
+    bool enqueue(waiter &w) noexcept {
+        auto old = state.load(std::memory_order_relaxed);
+        for (;;) {
+            if (old == not_locked) {
+                if (state.compare_exchange_weak(old, locked_no_waiters, std::memory_order_acquire,
+                                                std::memory_order_relaxed))
+                    return true;
+            } else {
+                w.next = reinterpret_cast<waiter *>(old);
+                if (state.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(&w),
+                                                std::memory_order_release, std::memory_order_relaxed))
+                    return false;
+            }
+        }
+    }
+
+  private:
+    // Member variables
+    // The lock state or the LIFO stack of newly queued waiters.
+    std::atomic<std::uintptr_t> state{not_locked};
+    // The FIFO list of waiters, owned by the lock holder.
+    waiter *waiters = nullptr;
+    // Bumped on every handoff to the blocked thread, which waits on it.
+    std::atomic<std::uint32_t> handoffs{0};
+};
+
+} // end namespace im
+
+#endif
+
+#endif //SMARTMUTEX__ASYNC_MUTEX_H_
@@ -0,0 +1,482 @@
+// Implementation of the bounded lock-free channel for passing values between threads.
+//
+
+#ifndef SMARTMUTEX__CHANNEL_H_
+#define SMARTMUTEX__CHANNEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @class channel
+ * @brief Bounded multi-producer multi-consumer queue for hand-off between threads,
+ * e.g. instead of <code>smart_mutex<std::deque<Msg>></code>. Backed by the ring
+ * buffer with the sequence number per cell (D. Vyukov's bounded MPMC queue), so
+ * producers and consumers only contend on their own index, which are kept on separate
+ * cache lines, and never block each other unless the channel is full or empty. Values
+ * are written and read in place through write_access and read_access proxies, like
+ * with smart_mutex, or pushed and popped by value, one by one or in batches claimed
+ * by a single atomic operation.
+ * @tparam T The type of values, it has to be nothrow move constructible.
+ * @tparam Capacity The maximum number of values in the channel, the power of two.
+ */
+template<class T, std::size_t Capacity>
+class channel
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "channel capacity must be the power of two, at least 2");
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "channel requires nothrow move constructible T");
+
+    struct cell
+    {
+        // The position it is free to write at, or the position + 1 once written.
+        std::atomic<std::size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    static constexpr std::size_t mask = Capacity - 1;
+
+  public:
+    // Container specific types
+    /**
+     * @class write_access
+     * @brief Proxy object owning the reserved cell at the back of the channel, the value
+     * is default constructed in place and becomes visible to consumers once the proxy is
+     * destroyed. Consumers of the following values wait for it, so keep it short living.
+     */
+    struct write_access
+    {
+        write_access(write_access &&other) noexcept
+            : ref(other.ref), slot(std::exchange(other.slot, nullptr)), position(other.position) {
+        }
+
+        write_access(const write_access &) = delete;
+        write_access &operator=(const write_access &) = delete;
+
+        /**
+         * @brief Publish the written value.
+         */
+        ~write_access() {
+            if (slot)
+                ref.publish(slot, position);
+        }
+
+        /**
+         * @brief Check if the cell was reserved, the value could be accessed only in this case.
+         * @return true if the cell is owned.
+         */
+        explicit operator bool() const noexcept { return slot != nullptr; }
+
+        /**
+         * @brief Get the pointer to the value being written.
+         * @return The value pointer.
+         */
+        T *operator->() const noexcept { return slot->value(); }
+
+        /**
+         * @brief Get the reference to the value being written.
+         * @return The value reference.
+         */
+        T &operator*() const noexcept { return *slot->value(); }
+
+      private:
+        friend class channel;
+
+        write_access(channel &ref, cell *slot, std::size_t position) noexcept
+            : ref(ref), slot(slot), position(position) {
+            if (slot)
+                ::new (static_cast<void *>(slot->storage)) T();
+        }
+
+        // The internal reference to overlying channel object.
+        channel &ref;
+        // The reserved cell, nullptr if the channel was full.
+        cell *slot;
+        // The position of the cell.
+        std::size_t position;
+    };
+
+    /**
+     * @class read_access
+     * @brief Proxy object owning the value taken from the front of the channel, the
+     * value could be read or moved out, it is destroyed and the cell is freed for
+     * producers once the proxy is destroyed.
+     */
+    struct read_access
+    {
+        read_access(read_access &&other) noexcept
+            : ref(other.ref), slot(std::exchange(other.slot, nullptr)), position(other.position) {
+        }
+
+        read_access(const read_access &) = delete;
+        read_access &operator=(const read_access &) = delete;
+
+        /**
+         * @brief Destroy the value and free the cell.
+         */
+        ~read_access() {
+            if (slot)
+                ref.release(slot, position);
+        }
+
+        /**
+         * @brief Check if the value was taken, it could be accessed only in this case.
+         * @return true if the cell is owned.
+         */
+        explicit operator bool() const noexcept { return slot != nullptr; }
+
+        /**
+         * @brief Get the pointer to the taken value.
+         * @return The value pointer.
+         */
+        T *operator->() const noexcept { return slot->value(); }
+
+        /**
+         * @brief Get the reference to the taken value.
+         * @return The value reference.
+         */
+        T &operator*() const noexcept { return *slot->value(); }
+
+      private:
+        friend class channel;
+
+        read_access(channel &ref, cell *slot, std::size_t position) noexcept
+            : ref(ref), slot(slot), position(position) {
+        }
+
+        // The internal reference to overlying channel object.
+        channel &ref;
+        // The owned cell, nullptr if the channel was empty.
+        cell *slot;
+        // The position of the cell.
+        std::size_t position;
+    };
+
+  public:
+    // Construction/Destruction
+    channel() noexcept {
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Destroy the values left in the channel, no other thread may access it.
+     */
+    ~channel() {
+        while (try_pop()) {
+        }
+    }
+
+    channel(const channel &) = delete;
+    channel &operator=(const channel &) = delete;
+
+    // Capacity
+    /**
+     * @brief The maximum number of values in the channel.
+     * @return Capacity.
+     */
+    static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    /**
+     * @brief The number of values in the channel, including the ones being written
+     * and read. It may be outdated immediately.
+     * @return The approximate size.
+     */
+    std::size_t size() const noexcept {
+        const auto pushed = tail.position.load(std::memory_order_relaxed);
+        const auto popped = head.position.load(std::memory_order_relaxed);
+        return pushed > popped ? std::min(pushed - popped, Capacity) : 0;
+    }
+
+    /**
+     * @brief Check if the channel is empty, the result may be outdated immediately.
+     * @return true if there are no values.
+     */
+    bool empty() const noexcept { return size() == 0; }
+
+    // Element access
+    /**
+     * @brief Reserve the cell at the back without blocking, the value is default
+     * constructed in it. Requires nothrow default constructible T.
+     * @return write_access proxy, owning the cell only if the channel wasn't full.
+     */
+    write_access try_write() noexcept {
+        static_assert(std::is_nothrow_default_constructible_v<T>,
+                      "channel::try_write requires nothrow default constructible T");
+        std::size_t position;
+        auto *slot = claim_back(position);
+        return write_access(*this, slot, position);
+    }
+
+    /**
+     * @brief Reserve the cell at the back, waiting while the channel is full.
+     * @return write_access proxy owning the cell.
+     */
+    write_access write() noexcept {
+        static_assert(std::is_nothrow_default_constructible_v<T>,
+                      "channel::write requires nothrow default constructible T");
+        std::size_t position;
+        auto *slot = wait_for([this, &position]() { return claim_back(position); });
+        return write_access(*this, slot, position);
+    }
+
+    /**
+     * @brief Take the value from the front without blocking.
+     * @return read_access proxy, owning the value only if the channel wasn't empty.
+     */
+    read_access try_read() noexcept {
+        std::size_t position;
+        auto *slot = claim_front(position);
+        return read_access(*this, slot, position);
+    }
+
+    /**
+     * @brief Take the value from the front, waiting while the channel is empty.
+     * @return read_access proxy owning the value.
+     */
+    read_access read() noexcept {
+        std::size_t position;
+        auto *slot = wait_for([this, &position]() { return claim_front(position); });
+        return read_access(*this, slot, position);
+    }
+
+    // Modifiers
+    /**
+     * @brief Construct the value at the back without blocking. The value is constructed
+     * before the cell is reserved, so the exception leaves the channel unchanged.
+     * @param args Elements passed to the value constructor.
+     * @return true if the value was pushed, false if the channel was full.
+     */
+    template<typename ...Args>
+    bool try_emplace(Args &&...args) {
+        T value(std::forward<Args>(args)...);
+        std::size_t position;
+        auto *slot = claim_back(position);
+        if (!slot)
+            return false;
+        ::new (static_cast<void *>(slot->storage)) T(std::move(value));
+        publish(slot, position);
+        return true;
+    }
+
+    /**
+     * @brief Copy or move the value to the back without blocking.
+     * @param value The value to push.
+     * @return true if the value was pushed, false if the channel was full.
+     */
+    template<class U = T>
+    bool try_push(U &&value) {
+        return try_emplace(std::forward<U>(value));
+    }
+
+    /**
+     * @brief Copy or move the value to the back, waiting while the channel is full.
+     * @param value The value to push.
+     */
+    template<class U = T>
+    void push(U &&value) {
+        T pushed(std::forward<U>(value));
+        std::size_t position;
+        auto *slot = wait_for([this, &position]() { return claim_back(position); });
+        ::new (static_cast<void *>(slot->storage)) T(std::move(pushed));
+        publish(slot, position);
+    }
+
+    /**
+     * @brief Push values of the range without blocking, all cells available at once
+     * are reserved by one atomic operation. Values are copied from <code>*first</code>,
+     * use <code>std::make_move_iterator()</code> to move them.
+     * @param first The beginning of the range to push.
+     * @param last The end of the range to push.
+     * @return The number of pushed values from the beginning of the range, 0 if the channel was full.
+     */
+    template<class It>
+    std::size_t try_push(It first, It last) {
+        if constexpr (!std::is_nothrow_constructible_v<T, decltype(*first)>) {
+            // The exception could be thrown after the cells were reserved.
+            std::size_t pushed = 0;
+            for (; first != last && try_emplace(*first); ++first)
+                ++pushed;
+            return pushed;
+        } else {
+            std::size_t position;
+            const auto count = claim_back(position, static_cast<std::size_t>(std::distance(first, last)));
+            for (std::size_t i = 0; i < count; ++i, ++first) {
+                auto *slot = &cells[(position + i) & mask];
+                ::new (static_cast<void *>(slot->storage)) T(*first);
+                publish(slot, position + i);
+            }
+            return count;
+        }
+    }
+
+    /**
+     * @brief Pop the value from the front without blocking.
+     * @return The value, empty if the channel was empty.
+     */
+    std::optional<T> try_pop() noexcept {
+        std::size_t position;
+        auto *slot = claim_front(position);
+        if (!slot)
+            return std::nullopt;
+        std::optional<T> value(std::move(*slot->value()));
+        release(slot, position);
+        return value;
+    }
+
+    /**
+     * @brief Pop the value from the front, waiting while the channel is empty.
+     * @return The value.
+     */
+    T pop() noexcept {
+        std::size_t position;
+        auto *slot = wait_for([this, &position]() { return claim_front(position); });
+        T value(std::move(*slot->value()));
+        release(slot, position);
+        return value;
+    }
+
+    /**
+     * @brief Pop up to count values from the front without blocking, all values
+     * available at once are taken by one atomic operation.
+     * @param out The output iterator the values are moved to.
+     * @param count The maximum number of values to pop.
+     * @return The number of popped values, 0 if the channel was empty. If the output
+     * throws, the rest of taken values are destroyed.
+     */
+    template<class OutputIt>
+    std::size_t try_pop(OutputIt out, std::size_t count) {
+        std::size_t position;
+        count = claim_front(position, count);
+        std::size_t i = 0;
+        try {
+            for (; i < count; ++i) {
+                auto *slot = &cells[(position + i) & mask];
+                *out = std::move(*slot->value());
+                ++out;
+                release(slot, position + i);
+            }
+        } catch (...) {
+            // The taken cells have to be freed anyway, the values not moved out are lost.
+            for (; i < count; ++i)
+                release(&cells[(position + i) & mask], position + i);
+            throw;
+        }
+        return count;
+    }
+
+  private:
+    // Reserve up to count cells at the back, which are free at the moment, the first
+    // one has to be free. The sequence of the free cell is equal to its position.
+    std::size_t claim_back(std::size_t &position, std::size_t count) noexcept {
+        return claim(tail.position, position, count, 0);
+    }
+
+    cell *claim_back(std::size_t &position) noexcept {
+        return claim_back(position, 1) ? &cells[position & mask] : nullptr;
+    }
+
+    // Take up to count written cells from the front. The sequence of the written
+    // cell is its position + 1.
+    std::size_t claim_front(std::size_t &position, std::size_t count) noexcept {
+        return claim(head.position, position, count, 1);
+    }
+
+    cell *claim_front(std::size_t &position) noexcept {
+        return claim_front(position, 1) ? &cells[position & mask] : nullptr;
+    }
+
+    std::size_t claim(std::atomic<std::size_t> &index, std::size_t &position, std::size_t count,
+                      std::size_t ready) noexcept {
+        count = std::min(count, Capacity);
+        if (count == 0)
+            return 0;
+        position = index.load(std::memory_order_relaxed);
+        for (;;) {
+            const auto sequence = cells[position & mask].sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<std::ptrdiff_t>(sequence - (position + ready));
+            if (lag < 0)
+                return 0;
+            if (lag > 0) {
+                // Another thread claimed the cell, retry from the current index.
+                position = index.load(std::memory_order_relaxed);
+                continue;
+            }
+            // Extend the claim over the following cells in the same state, they can't
+            // change until the index is moved past them.
+            std::size_t available = 1;
+            while (available < count &&
+                   cells[(position + available) & mask].sequence.load(std::memory_order_acquire) ==
+                       position + available + ready)
+                ++available;
+            if (index.compare_exchange_weak(position, position + available, std::memory_order_relaxed))
+                return available;
+        }
+    }
+
+    // Make the written cell visible to consumers.
+    void publish(cell *slot, std::size_t position) noexcept {
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    // Destroy the read value and free the cell for the producer of the next round.
+    void release(cell *slot, std::size_t position) noexcept {
+        slot->value()->~T();
+        slot->sequence.store(position + Capacity, std::memory_order_release);
+    }
+
+    // Spin while claim() fails, then yield to the threads which make progress.
+    template<class Claim>
+    static cell *wait_for(Claim claim) noexcept {
+        constexpr std::uint32_t spins = 1024, max_backoff = 64;
+        std::uint32_t spun = 0, backoff = 1;
+        for (;;) {
+            if (auto *slot = claim())
+                return slot;
+            if (spun < spins) {
+                for (std::uint32_t i = 0; i < backoff; ++i)
+                    detail::cpu_relax();
+                spun += backoff;
+                backoff = std::min(backoff * 2, max_backoff);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // The position of the producers or consumers, on its own cache line.
+    struct alignas(detail::cache_line_size) index
+    {
+        std::atomic<std::size_t> position{0};
+    };
+
+  private:
+    // Member variables
+    // The next position to push at.
+    index tail;
+    // The next position to pop from.
+    index head;
+    // The ring buffer, after the indices so the last cells don't share the line with them.
+    alignas(detail::cache_line_size) cell cells[Capacity];
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__CHANNEL_H_
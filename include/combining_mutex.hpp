@@ -0,0 +1,195 @@
+// Implementation of the flat combining mutex policy.
+//
+
+#ifndef SMARTMUTEX__COMBINING_MUTEX_H_
+#define SMARTMUTEX__COMBINING_MUTEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+namespace detail
+{
+
+/**
+ * @brief Type erased operation published to the combining_mutex slot.
+ */
+struct combine_request
+{
+    // Run the operation, the combining_mutex has to be owned by the caller.
+    void (*invoke)(combine_request &) noexcept = nullptr;
+    // Set by the combiner after the operation has finished.
+    std::atomic<bool> done{false};
+};
+
+/**
+ * @brief The operation with its result, lives on the stack of the publishing thread.
+ */
+template<typename Fn, typename R>
+struct combine_task : combine_request
+{
+    static_assert(!std::is_reference_v<R>, "combined operation has to return by value");
+
+    explicit combine_task(Fn &fn) : fn(fn) {
+        invoke = [](combine_request &request) noexcept { static_cast<combine_task &>(request).run(); };
+    }
+
+    void run() noexcept {
+        try {
+            if constexpr (std::is_void_v<R>)
+                std::invoke(fn);
+            else
+                result.emplace(std::invoke(fn));
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    R get() {
+        if (error)
+            std::rethrow_exception(error);
+        if constexpr (!std::is_void_v<R>)
+            return std::move(*result);
+    }
+
+    Fn &fn;
+    std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> result{};
+    std::exception_ptr error;
+};
+
+} // end namespace detail
+
+/**
+ * @class basic_combining_mutex
+ * @brief Flat combining mutex policy. Threads calling combine() publish their
+ * operations to the slot array, and whichever thread holds the lock executes all
+ * pending operations in one batch before releasing it, so the protected data stays
+ * hot in the cache of one core. Meets the Lockable requirements, plain lock holders
+ * (e.g. write_access) combine pending operations on unlock as well.
+ * @tparam Mutex The underlying Mutex type.
+ * @tparam Slots The number of publication slots.
+ */
+template<class Mutex = std::mutex, std::size_t Slots = 64>
+class basic_combining_mutex
+{
+    // Number of spins waiting for the combiner before blocking on the lock.
+    static constexpr std::uint32_t spins = 512;
+
+  public:
+    basic_combining_mutex() = default;
+
+    basic_combining_mutex(const basic_combining_mutex &) = delete;
+    basic_combining_mutex &operator=(const basic_combining_mutex &) = delete;
+
+    /**
+     * @brief Lock the underlying mutex.
+     */
+    void lock() { mutex.lock(); }
+
+    /**
+     * @brief Try to lock the underlying mutex.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() { return mutex.try_lock(); }
+
+    /**
+     * @brief Execute pending operations and unlock the underlying mutex.
+     */
+    void unlock() {
+        combine_pending();
+        mutex.unlock();
+    }
+
+    /**
+     * @brief Execute the function by the current lock holder, possibly the caller
+     * itself, together with operations of other threads.
+     * @param fn The function to execute under the lock.
+     * @return The function result, exceptions are rethrown in the calling thread.
+     */
+    template<typename Fn>
+    std::invoke_result_t<Fn &> combine(Fn &&fn) {
+        detail::combine_task<Fn, std::invoke_result_t<Fn &>> task(fn);
+        if (mutex.try_lock()) {
+            // Uncontended, nobody to combine with.
+            task.run();
+            unlock();
+        } else if (publish(task)) {
+            for (std::uint32_t i = 0; i < spins && !task.done.load(std::memory_order_acquire); ++i) {
+                if (i % 16 == 0 && mutex.try_lock()) {
+                    unlock();
+                    break;
+                }
+                detail::cpu_relax();
+            }
+            if (!task.done.load(std::memory_order_acquire)) {
+                lock();
+                unlock();
+            }
+        } else {
+            // All slots are busy, execute directly.
+            lock();
+            task.run();
+            unlock();
+        }
+        return task.get();
+    }
+
+  private:
+    bool publish(detail::combine_request &request) noexcept {
+        static thread_local const std::size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        pending.fetch_add(1, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < Slots; ++i) {
+            auto &slot = slots[(hint + i) % Slots];
+            detail::combine_request *expected = nullptr;
+            if (slot.load(std::memory_order_relaxed) == nullptr &&
+                slot.compare_exchange_strong(expected, &request, std::memory_order_release,
+                                             std::memory_order_relaxed))
+                return true;
+        }
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void combine_pending() noexcept {
+        if (pending.load(std::memory_order_acquire) == 0)
+            return;
+        for (auto &slot : slots) {
+            if (slot.load(std::memory_order_relaxed) == nullptr)
+                continue;
+            auto *request = slot.exchange(nullptr, std::memory_order_acquire);
+            if (!request)
+                continue;
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            request->invoke(*request);
+            request->done.store(true, std::memory_order_release);
+        }
+    }
+
+  private:
+    // Member variables
+    // The underlying mutex.
+    Mutex mutex;
+    // The number of published and not yet combined operations.
+    alignas(detail::cache_line_size) std::atomic<std::uint32_t> pending{0};
+    // The publication slots.
+    std::atomic<detail::combine_request *> slots[Slots] = {};
+};
+
+//! Flat combining mutex with the default underlying mutex and slots count.
+typedef basic_combining_mutex<> combining_mutex;
+
+} // end namespace im
+
+#endif //SMARTMUTEX__COMBINING_MUTEX_H_
@@ -0,0 +1,77 @@
+// Portable wait/notify on 32-bit atomics used by smart_mutex family primitives.
+//
+
+#ifndef SMARTMUTEX__DETAIL_ATOMIC_WAIT_H_
+#define SMARTMUTEX__DETAIL_ATOMIC_WAIT_H_
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#if !defined(__cpp_lib_atomic_wait) && defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace im
+{
+
+namespace detail
+{
+
+/**
+ * @brief Block the calling thread while the atomic holds the old value.
+ * Uses <code>std::atomic::wait</code> when available (C++20), futex on Linux,
+ * or the scheduler yield loop otherwise. Spurious wake ups are possible.
+ * @param atomic The atomic to wait on.
+ * @param old The value to wait while it is held.
+ */
+inline void atomic_wait(const std::atomic<std::uint32_t> &atomic, std::uint32_t old) noexcept {
+#if defined(__cpp_lib_atomic_wait)
+    atomic.wait(old, std::memory_order_relaxed);
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<const std::uint32_t *>(&atomic), FUTEX_WAIT_PRIVATE, old,
+            nullptr, nullptr, 0);
+#else
+    while (atomic.load(std::memory_order_relaxed) == old)
+        std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Wake up one thread blocked in atomic_wait() on the atomic.
+ * @param atomic The atomic to notify.
+ */
+inline void atomic_notify_one(std::atomic<std::uint32_t> &atomic) noexcept {
+#if defined(__cpp_lib_atomic_wait)
+    atomic.notify_one();
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&atomic), FUTEX_WAKE_PRIVATE, 1,
+            nullptr, nullptr, 0);
+#else
+    (void) atomic;
+#endif
+}
+
+/**
+ * @brief Wake up all threads blocked in atomic_wait() on the atomic.
+ * @param atomic The atomic to notify.
+ */
+inline void atomic_notify_all(std::atomic<std::uint32_t> &atomic) noexcept {
+#if defined(__cpp_lib_atomic_wait)
+    atomic.notify_all();
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&atomic), FUTEX_WAKE_PRIVATE, INT_MAX,
+            nullptr, nullptr, 0);
+#else
+    (void) atomic;
+#endif
+}
+
+} // end namespace detail
+
+} // end namespace im
+
+#endif //SMARTMUTEX__DETAIL_ATOMIC_WAIT_H_
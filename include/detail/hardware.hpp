@@ -0,0 +1,137 @@
+// Hardware specific helpers shared by smart_mutex family primitives.
+//
+
+#ifndef SMARTMUTEX__DETAIL_HARDWARE_H_
+#define SMARTMUTEX__DETAIL_HARDWARE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Prevent inlining of the function, e.g. to keep its return address meaningful.
+#if defined(__GNUC__) || defined(__clang__)
+#define SMART_MUTEX_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define SMART_MUTEX_NOINLINE __declspec(noinline)
+#else
+#define SMART_MUTEX_NOINLINE
+#endif
+
+// The return address of the current function, nullptr if unsupported.
+#if defined(__GNUC__) || defined(__clang__)
+#define SMART_MUTEX_RETURN_ADDRESS() __builtin_return_address(0)
+#elif defined(_MSC_VER)
+#define SMART_MUTEX_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define SMART_MUTEX_RETURN_ADDRESS() nullptr
+#endif
+
+// Let the empty member share the address of others, MSVC ignores the standard attribute.
+#if defined(_MSC_VER) && _MSC_VER >= 1929
+#define SMART_MUTEX_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#define SMART_MUTEX_HAS_NO_UNIQUE_ADDRESS 1
+#elif defined(__has_cpp_attribute) && !defined(_MSC_VER)
+#if __has_cpp_attribute(no_unique_address)
+#define SMART_MUTEX_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#define SMART_MUTEX_HAS_NO_UNIQUE_ADDRESS 1
+#endif
+#endif
+#if !defined(SMART_MUTEX_NO_UNIQUE_ADDRESS)
+#define SMART_MUTEX_NO_UNIQUE_ADDRESS
+#define SMART_MUTEX_HAS_NO_UNIQUE_ADDRESS 0
+#endif
+
+namespace im
+{
+
+namespace detail
+{
+
+/**
+ * @brief The size of the cache line used for false sharing avoidance. GCC warns the
+ * standard constant is not ABI stable, so the value is fixed there and could be
+ * overridden by defining SMART_MUTEX_CACHE_LINE_SIZE.
+ */
+#if defined(SMART_MUTEX_CACHE_LINE_SIZE)
+inline constexpr std::size_t cache_line_size = SMART_MUTEX_CACHE_LINE_SIZE;
+#elif defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+inline constexpr std::size_t cache_line_size = std::hardware_destructive_interference_size;
+#elif (defined(__aarch64__) && defined(__APPLE__)) || defined(__powerpc64__)
+inline constexpr std::size_t cache_line_size = 128;
+#else
+inline constexpr std::size_t cache_line_size = 64;
+#endif
+
+/**
+ * @brief Hint the CPU that the caller is in the spin-wait loop.
+ * Lowers power consumption and frees pipeline resources for the sibling
+ * hyper-thread, falls back to the scheduler yield on unknown platforms.
+ */
+inline void cpu_relax() noexcept {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Read the cheap monotonic CPU tick counter (TSC on x86, virtual counter
+ * on ARM64), steady clock nanoseconds on other platforms.
+ * @return Current ticks.
+ */
+inline std::uint64_t cpu_ticks() noexcept {
+#if defined(__i386__) || defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/**
+ * @brief Get the rate of cpu_ticks(). Calibrated against the steady clock on
+ * the first call, which blocks the caller for a few milliseconds.
+ * @return Ticks per nanosecond.
+ */
+inline double cpu_ticks_per_nanosecond() {
+#if defined(__i386__) || defined(__x86_64__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+    static const double rate = [] {
+        const auto start = std::chrono::steady_clock::now();
+        const auto start_ticks = cpu_ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto ticks = static_cast<double>(cpu_ticks() - start_ticks);
+        const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        return ticks / elapsed.count();
+    }();
+    return rate;
+#elif defined(__aarch64__)
+    std::uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return static_cast<double>(frequency) / 1e9;
+#else
+    return 1.0;
+#endif
+}
+
+} // end namespace detail
+
+} // end namespace im
+
+#endif //SMARTMUTEX__DETAIL_HARDWARE_H_
@@ -0,0 +1,383 @@
+// Lock order checker of smart_mutex family primitives, see SMART_MUTEX_LOCK_ORDER_CHECK.
+//
+
+#ifndef SMARTMUTEX__DETAIL_LOCK_ORDER_H_
+#define SMARTMUTEX__DETAIL_LOCK_ORDER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @struct lock_order_violation
+ * @brief Report of two locks acquired in the order inverse to the one seen before,
+ * i.e. of the potential deadlock between threads taking them in different orders.
+ */
+struct lock_order_violation
+{
+    //! Address of the mutex held by the thread, the same as of the owning smart_mutex with the packed layout.
+    const void *held = nullptr;
+    //! Address of the mutex being acquired, which was held while held (or the chain to it) was acquired before.
+    const void *acquired = nullptr;
+    //! Return address of the lock() call, identifies the acquiring code (e.g. with addr2line).
+    const void *site = nullptr;
+};
+
+//! The function called for every lock order violation.
+typedef void (*lock_order_violation_handler)(const lock_order_violation &);
+
+namespace detail
+{
+
+// The violation handler, violations are printed to stderr if it isn't set.
+inline std::atomic<lock_order_violation_handler> lock_order_handler{nullptr};
+
+/**
+ * @brief The global lock order graph, the edge from one lock to another means the
+ * second was acquired while the first one was held. The edge closing the cycle is
+ * the potential deadlock.
+ */
+class lock_order_graph
+{
+    // Edges of one lock.
+    struct node
+    {
+        std::unordered_set<std::uint64_t> out;
+        std::unordered_set<std::uint64_t> in;
+    };
+
+  public:
+    static lock_order_graph &instance() {
+        static lock_order_graph graph;
+        return graph;
+    }
+
+    /**
+     * @brief Add the edge if it is new.
+     * @return true if the edge is new and closes the cycle.
+     */
+    bool add(std::uint64_t from, std::uint64_t to) {
+        std::lock_guard lock(mutex);
+        if (!nodes[from].out.insert(to).second)
+            return false;
+        nodes[to].in.insert(from);
+        return reaches(to, from);
+    }
+
+    /**
+     * @brief Remove the destroyed lock with all its edges.
+     */
+    void forget(std::uint64_t id) {
+        std::lock_guard lock(mutex);
+        const auto it = nodes.find(id);
+        if (it == nodes.end())
+            return;
+        for (const auto to : it->second.out)
+            nodes[to].in.erase(id);
+        for (const auto from : it->second.in)
+            nodes[from].out.erase(id);
+        nodes.erase(it);
+    }
+
+  private:
+    lock_order_graph() = default;
+
+    // Depth first search of the path.
+    bool reaches(std::uint64_t from, std::uint64_t to) const {
+        std::vector<std::uint64_t> pending{from};
+        std::unordered_set<std::uint64_t> visited{from};
+        while (!pending.empty()) {
+            const auto id = pending.back();
+            pending.pop_back();
+            if (id == to)
+                return true;
+            const auto it = nodes.find(id);
+            if (it == nodes.end())
+                continue;
+            for (const auto next : it->second.out) {
+                if (visited.insert(next).second)
+                    pending.push_back(next);
+            }
+        }
+        return false;
+    }
+
+  private:
+    // Member variables
+    // Protects the graph, never checked itself.
+    std::mutex mutex;
+    // The locks which were ever held together with others.
+    std::unordered_map<std::uint64_t, node> nodes;
+};
+
+/**
+ * @brief The identity of the checked lock. Ids are never reused, unlike addresses,
+ * so locks created in place of destroyed ones don't inherit their edges.
+ */
+class lock_order_node
+{
+  public:
+    lock_order_node(const lock_order_node &) = delete;
+    lock_order_node &operator=(const lock_order_node &) = delete;
+
+  protected:
+    lock_order_node() noexcept : id(next_id()) {
+    }
+
+    ~lock_order_node() {
+        if (ordered.load(std::memory_order_relaxed))
+            lock_order_graph::instance().forget(id);
+    }
+
+    // Per-thread state of the checker.
+    struct thread_state
+    {
+        // Edges already added to the graph by the thread, bounded by limit.
+        struct edge_hash
+        {
+            std::size_t operator()(const std::pair<std::uint64_t, std::uint64_t> &edge) const noexcept {
+                return std::hash<std::uint64_t>()(edge.first * 0x9e3779b97f4a7c15ull ^ edge.second);
+            }
+        };
+        static constexpr std::size_t limit = 4096;
+
+        // The locks held by the thread in the acquisition order.
+        std::vector<const lock_order_node *> held;
+        std::unordered_set<std::pair<std::uint64_t, std::uint64_t>, edge_hash> known;
+    };
+
+    static thread_state &current() noexcept {
+        thread_local thread_state state;
+        return state;
+    }
+
+    // Add edges from all held locks, before blocking on this one.
+    void acquiring(const void *site) const {
+        auto &state = current();
+        for (const auto *held : state.held) {
+            // Recursive acquisition.
+            if (held == this)
+                continue;
+            if (state.known.size() >= thread_state::limit)
+                state.known.clear();
+            if (!state.known.emplace(held->id, id).second)
+                continue;
+            held->ordered.store(true, std::memory_order_relaxed);
+            ordered.store(true, std::memory_order_relaxed);
+            if (lock_order_graph::instance().add(held->id, id))
+                report(held, site);
+        }
+    }
+
+    void acquired() const {
+        current().held.push_back(this);
+    }
+
+    // Locks may be released in any order.
+    void released() const noexcept {
+        auto &held = current().held;
+        const auto it = std::find(held.rbegin(), held.rend(), this);
+        if (it != held.rend())
+            held.erase(std::next(it).base());
+    }
+
+  private:
+    static std::uint64_t next_id() noexcept {
+        // Ids are taken from the global counter by blocks.
+        constexpr std::uint64_t block = 1024;
+        static std::atomic<std::uint64_t> blocks{0};
+        thread_local std::uint64_t next = 0;
+        thread_local std::uint64_t end = 0;
+        if (next == end) {
+            next = blocks.fetch_add(block, std::memory_order_relaxed);
+            end = next + block;
+        }
+        return next++;
+    }
+
+    // Kept out of line, violations are rare.
+    SMART_MUTEX_NOINLINE void report(const lock_order_node *held, const void *site) const {
+        lock_order_violation violation;
+        violation.held = held;
+        violation.acquired = this;
+        violation.site = site;
+        if (const auto handler = lock_order_handler.load(std::memory_order_acquire)) {
+            handler(violation);
+            return;
+        }
+        std::fprintf(stderr, "smart_mutex: lock order inversion, %p acquired at %p while holding %p\n",
+                     violation.acquired, violation.site, violation.held);
+    }
+
+  private:
+    // Member variables
+    // The unique id of the lock.
+    const std::uint64_t id;
+    // Whether the lock is in the graph.
+    mutable std::atomic<bool> ordered{false};
+};
+
+/**
+ * @class lock_order_checked
+ * @brief Mutex policy wrapper checking the lock order. Blocking acquisitions add
+ * the edges from the locks held by the thread to the global graph, and the edge closing
+ * the cycle is reported once, the first time the inverse order is seen, even if the
+ * deadlock didn't happen. Non blocking and timed acquisitions can't deadlock, so
+ * they are only recorded as held. The acquisition with no other locks held, which
+ * is the common case, doesn't touch the graph, and every pair of locks takes the
+ * graph lock once per thread. The lock order of critical sections executed by the
+ * combining Mutex on behalf of other threads isn't checked.
+ * @tparam Mutex The checked Mutex type, keeps meeting the same requirements.
+ */
+template<class Mutex>
+class lock_order_checked : private lock_order_node
+{
+  public:
+    lock_order_checked() = default;
+
+    // Exclusive ownership
+    SMART_MUTEX_NOINLINE void lock() {
+        acquiring(SMART_MUTEX_RETURN_ADDRESS());
+        mutex.lock();
+        acquired();
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock())
+            return false;
+        acquired();
+        return true;
+    }
+
+    template<class Rep, class Period, class M = Mutex>
+    auto try_lock_for(const std::chrono::duration<Rep, Period> &timeout)
+        -> decltype(std::declval<M &>().try_lock_for(timeout)) {
+        return checked(mutex.try_lock_for(timeout));
+    }
+
+    template<class Clock, class Duration, class M = Mutex>
+    auto try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline)
+        -> decltype(std::declval<M &>().try_lock_until(deadline)) {
+        return checked(mutex.try_lock_until(deadline));
+    }
+
+    void unlock() {
+        released();
+        mutex.unlock();
+    }
+
+    // Shared ownership
+    template<class M = Mutex>
+    SMART_MUTEX_NOINLINE auto lock_shared() -> decltype(std::declval<M &>().lock_shared()) {
+        acquiring(SMART_MUTEX_RETURN_ADDRESS());
+        mutex.lock_shared();
+        acquired();
+    }
+
+    template<class M = Mutex>
+    auto try_lock_shared() -> decltype(std::declval<M &>().try_lock_shared()) {
+        return checked(mutex.try_lock_shared());
+    }
+
+    template<class Rep, class Period, class M = Mutex>
+    auto try_lock_shared_for(const std::chrono::duration<Rep, Period> &timeout)
+        -> decltype(std::declval<M &>().try_lock_shared_for(timeout)) {
+        return checked(mutex.try_lock_shared_for(timeout));
+    }
+
+    template<class Clock, class Duration, class M = Mutex>
+    auto try_lock_shared_until(const std::chrono::time_point<Clock, Duration> &deadline)
+        -> decltype(std::declval<M &>().try_lock_shared_until(deadline)) {
+        return checked(mutex.try_lock_shared_until(deadline));
+    }
+
+    template<class M = Mutex>
+    auto unlock_shared() -> decltype(std::declval<M &>().unlock_shared()) {
+        released();
+        mutex.unlock_shared();
+    }
+
+    // Upgrade ownership, promotion and demotion keep the lock held.
+    template<class M = Mutex>
+    SMART_MUTEX_NOINLINE auto lock_upgrade() -> decltype(std::declval<M &>().lock_upgrade()) {
+        acquiring(SMART_MUTEX_RETURN_ADDRESS());
+        mutex.lock_upgrade();
+        acquired();
+    }
+
+    template<class M = Mutex>
+    auto try_lock_upgrade() -> decltype(std::declval<M &>().try_lock_upgrade()) {
+        return checked(mutex.try_lock_upgrade());
+    }
+
+    template<class M = Mutex>
+    auto unlock_upgrade() -> decltype(std::declval<M &>().unlock_upgrade()) {
+        released();
+        mutex.unlock_upgrade();
+    }
+
+    template<class M = Mutex>
+    auto unlock_upgrade_and_lock() -> decltype(std::declval<M &>().unlock_upgrade_and_lock()) {
+        mutex.unlock_upgrade_and_lock();
+    }
+
+    template<class M = Mutex>
+    auto try_unlock_upgrade_and_lock() -> decltype(std::declval<M &>().try_unlock_upgrade_and_lock()) {
+        return mutex.try_unlock_upgrade_and_lock();
+    }
+
+    template<class M = Mutex>
+    auto unlock_and_lock_upgrade() -> decltype(std::declval<M &>().unlock_and_lock_upgrade()) {
+        mutex.unlock_and_lock_upgrade();
+    }
+
+    // Flat combining
+    template<typename Fn, class M = Mutex>
+    auto combine(Fn &&fn) -> decltype(std::declval<M &>().combine(std::forward<Fn>(fn))) {
+        return mutex.combine(std::forward<Fn>(fn));
+    }
+
+  private:
+    // Record the lock as held if the non blocking acquisition succeeded.
+    bool checked(bool locked) {
+        if (locked)
+            acquired();
+        return locked;
+    }
+
+  private:
+    // Member variables
+    // The checked mutex.
+    Mutex mutex;
+};
+
+} // end namespace detail
+
+/**
+ * @brief Set the function called when locks are acquired in the inverse order, in
+ * SMART_MUTEX_LOCK_ORDER_CHECK builds. It is called by the acquiring thread before
+ * it blocks, so the report is delivered even if the deadlock happens.
+ * @param handler The handler, nullptr to print violations to stderr.
+ * @return The previous handler.
+ */
+inline lock_order_violation_handler set_lock_order_violation_handler(lock_order_violation_handler handler) noexcept {
+    return detail::lock_order_handler.exchange(handler, std::memory_order_acq_rel);
+}
+
+} // end namespace im
+
+#endif //SMARTMUTEX__DETAIL_LOCK_ORDER_H_
@@ -0,0 +1,158 @@
+// Implementation of the hardware lock elision mutex policy.
+//
+
+#ifndef SMARTMUTEX__ELIDED_MUTEX_H_
+#define SMARTMUTEX__ELIDED_MUTEX_H_
+
+#include <cstdint>
+
+#if (defined(__i386__) || defined(__x86_64__)) && (defined(__GNUC__) || defined(__clang__))
+#define SMART_MUTEX_HAS_RTM_INTRINSICS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "adaptive_mutex.hpp"
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+namespace detail
+{
+
+/**
+ * @brief Check if the CPU supports Intel TSX restricted transactional memory.
+ * Many CPUs report it disabled by microcode, so it is detected at runtime.
+ * @return true if RTM instructions could be used.
+ */
+inline bool has_rtm() noexcept {
+#if defined(SMART_MUTEX_HAS_RTM_INTRINSICS)
+    static const bool supported = [] {
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_RTM) != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#if defined(SMART_MUTEX_HAS_RTM_INTRINSICS)
+// Abort code of the transaction which found the fallback lock taken.
+inline constexpr unsigned rtm_lock_busy = 0xff;
+
+__attribute__((target("rtm"))) inline unsigned rtm_begin() noexcept { return _xbegin(); }
+
+__attribute__((target("rtm"))) inline void rtm_end() noexcept { _xend(); }
+
+__attribute__((target("rtm"))) inline void rtm_abort_busy() noexcept { _xabort(rtm_lock_busy); }
+#endif
+
+} // end namespace detail
+
+/**
+ * @class basic_elided_mutex
+ * @brief Hardware lock elision mutex policy. The critical section is first executed
+ * as the hardware transaction, which only reads the lock word, so sections with
+ * non conflicting memory accesses (e.g. different buckets of one big table)
+ * run in parallel. After repeated aborts the lock is really taken, which aborts
+ * concurrent transactions. smart_mutex doesn't bump the version of the value
+ * with this policy, even with layout::versioned, so cached_read() and
+ * optimistic_read() are not available. Intel TSX (RTM) is detected at runtime.
+ * Without it, and on other architectures, this is the plain spin-then-park lock.
+ * Critical sections must not make system calls or do I/O, those always abort.
+ * Meets the Lockable requirements.
+ * @tparam Retries The number of transaction attempts before taking the lock.
+ * @tparam Spins The number of spin iterations waiting for the lock to be free before
+ * the next attempt, and before parking the thread on the fallback lock.
+ */
+template<std::uint32_t Retries = 3, std::uint32_t Spins = 128>
+class basic_elided_mutex
+{
+  public:
+    //! Critical sections run as transactions, so smart_mutex doesn't write its version in them.
+    static constexpr bool transactional = true;
+
+  public:
+    basic_elided_mutex() noexcept : elide(detail::has_rtm()) {
+    }
+
+    basic_elided_mutex(const basic_elided_mutex &) = delete;
+    basic_elided_mutex &operator=(const basic_elided_mutex &) = delete;
+
+    /**
+     * @brief Start the transaction, or lock the fallback lock after repeated aborts.
+     */
+    void lock() noexcept {
+#if defined(SMART_MUTEX_HAS_RTM_INTRINSICS)
+        if (elide && try_elide())
+            return;
+#endif
+        fallback.lock();
+    }
+
+    /**
+     * @brief Try to lock the fallback lock without blocking, the try is never elided.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        return fallback.try_lock();
+    }
+
+    /**
+     * @brief Commit the transaction, or unlock the fallback lock if it was taken.
+     */
+    void unlock() noexcept {
+#if defined(SMART_MUTEX_HAS_RTM_INTRINSICS)
+        // The fallback lock is seen free only inside the transaction, it would abort otherwise.
+        if (elide && !fallback.is_locked()) {
+            detail::rtm_end();
+            return;
+        }
+#endif
+        fallback.unlock();
+    }
+
+  private:
+#if defined(SMART_MUTEX_HAS_RTM_INTRINSICS)
+    // Try to start the transaction, returns true if the caller runs transactionally.
+    bool try_elide() noexcept {
+        for (std::uint32_t attempt = 0; attempt < Retries; ++attempt) {
+            const auto status = detail::rtm_begin();
+            if (status == _XBEGIN_STARTED) {
+                // Add the lock word to the read set, the real lock owner aborts us.
+                if (!fallback.is_locked())
+                    return true;
+                detail::rtm_abort_busy();
+            }
+            if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == detail::rtm_lock_busy) {
+                // Wait for the owner instead of aborting immediately again.
+                for (std::uint32_t i = 0; i < Spins && fallback.is_locked(); ++i)
+                    detail::cpu_relax();
+                continue;
+            }
+            // Capacity overflow, debug or unsupported instruction, retrying doesn't help.
+            if (!(status & _XABORT_RETRY) && !(status & _XABORT_CONFLICT))
+                return false;
+        }
+        return false;
+    }
+#endif
+
+  private:
+    // Member variables
+    // Whether transactions are supported by the CPU.
+    const bool elide;
+    // The lock taken when the transaction fails.
+    basic_adaptive_mutex<Spins> fallback;
+};
+
+//! Elided mutex with the default retries and spin count.
+typedef basic_elided_mutex<> elided_mutex;
+
+} // end namespace im
+
+#undef SMART_MUTEX_HAS_RTM_INTRINSICS
+
+#endif //SMARTMUTEX__ELIDED_MUTEX_H_
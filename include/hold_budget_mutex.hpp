@@ -0,0 +1,183 @@
+// Implementation of the lock hold time budget mutex policy.
+//
+
+#ifndef SMARTMUTEX__HOLD_BUDGET_MUTEX_H_
+#define SMARTMUTEX__HOLD_BUDGET_MUTEX_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @struct hold_violation
+ * @brief Report of the critical section which held the lock longer than the budget.
+ */
+struct hold_violation
+{
+    //! Address of the mutex, the same as of the owning smart_mutex with the packed layout.
+    const void *mutex = nullptr;
+    //! Return address of the lock() call, identifies the acquiring code (e.g. with addr2line).
+    const void *site = nullptr;
+    //! The time the lock was held.
+    std::uint64_t hold_ns = 0;
+    //! The budget in effect.
+    std::uint64_t budget_ns = 0;
+};
+
+//! The function called for every hold budget violation.
+typedef void (*hold_violation_handler)(const hold_violation &);
+
+namespace detail
+{
+
+// The budget in cpu_ticks(), zero if disabled.
+inline std::atomic<std::uint64_t> hold_budget_ticks{0};
+// The violation handler.
+inline std::atomic<hold_violation_handler> hold_handler{nullptr};
+
+} // end namespace detail
+
+/**
+ * @brief Set the hold time budget of all hold_budget_mutexes. The first call
+ * calibrates the tick counter, which blocks the caller for a few milliseconds.
+ * @param budget The maximum hold time, zero disables checking.
+ */
+inline void set_hold_budget(std::chrono::nanoseconds budget) {
+    const auto ticks = static_cast<double>(budget.count()) * detail::cpu_ticks_per_nanosecond();
+    detail::hold_budget_ticks.store(budget.count() > 0 ? static_cast<std::uint64_t>(ticks) : 0,
+                                    std::memory_order_relaxed);
+}
+
+/**
+ * @brief Set the function called when a hold_budget_mutex was held longer than the budget.
+ * It is called by the thread which released the lock, after releasing it.
+ * @param handler The handler, nullptr to ignore violations.
+ * @return The previous handler.
+ */
+inline hold_violation_handler set_hold_violation_handler(hold_violation_handler handler) noexcept {
+    return detail::hold_handler.exchange(handler, std::memory_order_acq_rel);
+}
+
+/**
+ * @class hold_budget_mutex
+ * @brief Mutex policy wrapper detecting slow critical sections, e.g. I/O or logging
+ * under write_access. Exclusive acquisition and release are timestamped with the CPU
+ * tick counter, and the hold time exceeding the budget set by im::set_hold_budget()
+ * is reported to the handler set by im::set_hold_violation_handler() together with
+ * the mutex address and the acquiring code address. The overhead is two tick reads
+ * and two relaxed loads per acquisition, so it is meant to stay enabled in production.
+ * With the zero budget nothing is timestamped.
+ * @tparam Mutex The checked Mutex type. SharedLockable mutexes stay SharedLockable,
+ * shared acquisitions aren't checked.
+ */
+template<class Mutex = std::mutex>
+class hold_budget_mutex
+{
+  public:
+    hold_budget_mutex() = default;
+
+    hold_budget_mutex(const hold_budget_mutex &) = delete;
+    hold_budget_mutex &operator=(const hold_budget_mutex &) = delete;
+
+    /**
+     * @brief Lock the underlying mutex and remember when and where it was acquired.
+     * Not inlined, so the return address points to the acquiring code.
+     */
+    SMART_MUTEX_NOINLINE void lock() {
+        mutex.lock();
+        acquired(SMART_MUTEX_RETURN_ADDRESS());
+    }
+
+    /**
+     * @brief Try to lock the underlying mutex.
+     * @return true if the lock was acquired.
+     */
+    SMART_MUTEX_NOINLINE bool try_lock() {
+        if (!mutex.try_lock())
+            return false;
+        acquired(SMART_MUTEX_RETURN_ADDRESS());
+        return true;
+    }
+
+    /**
+     * @brief Unlock the underlying mutex, report the violation if the hold exceeded the budget.
+     */
+    void unlock() {
+        if (acquired_ticks == 0) {
+            mutex.unlock();
+            return;
+        }
+        const auto hold = detail::cpu_ticks() - acquired_ticks;
+        const auto budget = detail::hold_budget_ticks.load(std::memory_order_relaxed);
+        const auto *site = acquired_site;
+        mutex.unlock();
+        if (budget != 0 && hold > budget)
+            report(site, hold, budget);
+    }
+
+    /**
+     * @brief Lock the underlying mutex in shared mode.
+     */
+    template<class M = Mutex>
+    auto lock_shared() -> decltype(std::declval<M &>().lock_shared()) {
+        mutex.lock_shared();
+    }
+
+    /**
+     * @brief Try to lock the underlying mutex in shared mode.
+     * @return true if the lock was acquired.
+     */
+    template<class M = Mutex>
+    auto try_lock_shared() -> decltype(std::declval<M &>().try_lock_shared()) {
+        return mutex.try_lock_shared();
+    }
+
+    /**
+     * @brief Unlock the underlying mutex in shared mode.
+     */
+    template<class M = Mutex>
+    auto unlock_shared() -> decltype(std::declval<M &>().unlock_shared()) {
+        mutex.unlock_shared();
+    }
+
+  private:
+    // Timestamp the acquisition, unless checking is disabled.
+    void acquired(const void *site) noexcept {
+        acquired_ticks = detail::hold_budget_ticks.load(std::memory_order_relaxed) != 0 ? detail::cpu_ticks() : 0;
+        acquired_site = site;
+    }
+
+    // Kept out of line, violations are rare.
+    SMART_MUTEX_NOINLINE void report(const void *site, std::uint64_t hold, std::uint64_t budget) const {
+        const auto handler = detail::hold_handler.load(std::memory_order_acquire);
+        if (!handler)
+            return;
+        const auto rate = detail::cpu_ticks_per_nanosecond();
+        hold_violation violation;
+        violation.mutex = this;
+        violation.site = site;
+        violation.hold_ns = static_cast<std::uint64_t>(static_cast<double>(hold) / rate);
+        violation.budget_ns = static_cast<std::uint64_t>(static_cast<double>(budget) / rate);
+        handler(violation);
+    }
+
+  private:
+    // Member variables
+    // The checked mutex.
+    Mutex mutex;
+    // The tick of the last exclusive acquisition, zero if it isn't checked.
+    std::uint64_t acquired_ticks = 0;
+    // The return address of the last exclusive acquisition.
+    const void *acquired_site = nullptr;
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__HOLD_BUDGET_MUTEX_H_
@@ -0,0 +1,115 @@
+// Implementation of the no-op mutex policy for single threaded use.
+//
+
+#ifndef SMARTMUTEX__NULL_MUTEX_H_
+#define SMARTMUTEX__NULL_MUTEX_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "smart_mutex.hpp"
+
+namespace im
+{
+
+/**
+ * @class null_mutex
+ * @brief Mutex policy which doesn't lock anything, e.g. for components instantiated
+ * both in multi-threaded servers and in single threaded tools. smart_mutex with it
+ * has no size overhead, its access proxies hold just the reference and compile down
+ * to the plain dereference, and no version or atomic copy of the value are kept.
+ * cached_read(), optimistic_read() and update() access the value directly.
+ * Meets the Lockable, TimedLockable, SharedTimedLockable and upgrade requirements,
+ * so any access of smart_mutex is available.
+ */
+class null_mutex
+{
+  public:
+    //! Nothing is synchronized, smart_mutex skips the lock guards.
+    static constexpr bool unsynchronized = true;
+
+  public:
+    constexpr null_mutex() noexcept = default;
+
+    null_mutex(const null_mutex &) = delete;
+    null_mutex &operator=(const null_mutex &) = delete;
+
+    // Exclusive ownership
+    constexpr void lock() noexcept {
+    }
+
+    constexpr bool try_lock() noexcept { return true; }
+
+    template<class Rep, class Period>
+    constexpr bool try_lock_for(const std::chrono::duration<Rep, Period> &) noexcept { return true; }
+
+    template<class Clock, class Duration>
+    constexpr bool try_lock_until(const std::chrono::time_point<Clock, Duration> &) noexcept { return true; }
+
+    constexpr void unlock() noexcept {
+    }
+
+    // Shared ownership
+    constexpr void lock_shared() noexcept {
+    }
+
+    constexpr bool try_lock_shared() noexcept { return true; }
+
+    template<class Rep, class Period>
+    constexpr bool try_lock_shared_for(const std::chrono::duration<Rep, Period> &) noexcept { return true; }
+
+    template<class Clock, class Duration>
+    constexpr bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration> &) noexcept { return true; }
+
+    constexpr void unlock_shared() noexcept {
+    }
+
+    // Upgrade ownership
+    constexpr void lock_upgrade() noexcept {
+    }
+
+    constexpr bool try_lock_upgrade() noexcept { return true; }
+
+    constexpr void unlock_upgrade() noexcept {
+    }
+
+    constexpr void unlock_upgrade_and_lock() noexcept {
+    }
+
+    constexpr bool try_unlock_upgrade_and_lock() noexcept { return true; }
+
+    constexpr void unlock_and_lock_upgrade() noexcept {
+    }
+
+    // Flat combining
+    /**
+     * @brief Run the function by the caller.
+     * @return The function result.
+     */
+    template<typename Fn>
+    std::invoke_result_t<Fn &> combine(Fn &&fn) {
+        return std::invoke(fn);
+    }
+};
+
+//! smart_mutex without any locking.
+template<class T>
+using unsynchronized_smart_mutex = smart_mutex<T, null_mutex>;
+
+// Empty members take no space only where SMART_MUTEX_NO_UNIQUE_ADDRESS is supported.
+#if SMART_MUTEX_HAS_NO_UNIQUE_ADDRESS
+static_assert(sizeof(unsynchronized_smart_mutex<std::uint64_t>) == sizeof(std::uint64_t),
+              "smart_mutex with null_mutex must not have size overhead");
+static_assert(sizeof(unsynchronized_smart_mutex<std::string>) == sizeof(std::string),
+              "smart_mutex with null_mutex must not have size overhead");
+static_assert(sizeof(unsynchronized_smart_mutex<std::string>::write_access) == sizeof(void *),
+              "access to smart_mutex with null_mutex must be the plain reference");
+#endif
+
+} // end namespace im
+
+#endif //SMARTMUTEX__NULL_MUTEX_H_
@@ -0,0 +1,215 @@
+// Implementation of the NUMA-aware cohort mutex policy.
+//
+
+#ifndef SMARTMUTEX__NUMA_COHORT_MUTEX_H_
+#define SMARTMUTEX__NUMA_COHORT_MUTEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "adaptive_mutex.hpp"
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+namespace detail
+{
+
+/**
+ * @brief CPU to NUMA node map, read once from sysfs. Hosts without sysfs
+ * (or non Linux ones) are treated as the single node.
+ */
+class numa_topology
+{
+  public:
+    static const numa_topology &instance() {
+        static const numa_topology topology;
+        return topology;
+    }
+
+    /**
+     * @brief The number of online NUMA nodes.
+     */
+    std::size_t node_count() const noexcept { return nodes; }
+
+    /**
+     * @brief The dense index of the node the calling thread currently runs on.
+     */
+    std::size_t current_node() const noexcept {
+        if (const int node = forced_node(); node >= 0)
+            return static_cast<std::size_t>(node);
+#if defined(__linux__)
+        const int cpu = sched_getcpu();
+        if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_nodes.size())
+            return cpu_nodes[cpu];
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Report the node of the calling thread instead of the one it runs on, e.g.
+     * for threads pinned to the node by the application, or to test the hand-off
+     * between nodes on the single node machine.
+     * @param node The dense node index, negative to use the current CPU again.
+     */
+    static void force_current_node(int node) noexcept {
+        forced_node() = node;
+    }
+
+  private:
+    numa_topology() {
+        std::size_t index = 0;
+        for (const auto node : read_list("/sys/devices/system/node/online")) {
+            for (const auto cpu : read_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+                if (cpu >= cpu_nodes.size())
+                    cpu_nodes.resize(cpu + 1, 0);
+                cpu_nodes[cpu] = static_cast<std::uint16_t>(index);
+            }
+            ++index;
+        }
+        nodes = index > 0 ? index : 1;
+    }
+
+    static int &forced_node() noexcept {
+        thread_local int node = -1;
+        return node;
+    }
+
+    // Parse the sysfs list format, e.g. "0-3,8-11".
+    static std::vector<std::size_t> read_list(const std::string &path) {
+        std::vector<std::size_t> list;
+        std::ifstream file(path);
+        std::string range;
+        while (std::getline(file, range, ',')) {
+            try {
+                const auto dash = range.find('-');
+                const auto first = std::stoul(range.substr(0, dash));
+                const auto last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                for (auto i = first; i <= last; ++i)
+                    list.push_back(i);
+            } catch (...) {
+                break;
+            }
+        }
+        return list;
+    }
+
+  private:
+    // Member variables
+    // The node index of every CPU.
+    std::vector<std::uint16_t> cpu_nodes;
+    // The number of nodes.
+    std::size_t nodes = 1;
+};
+
+} // end namespace detail
+
+/**
+ * @class basic_numa_cohort_mutex
+ * @brief NUMA-aware cohort lock. Threads first take the lock of their node and
+ * then the global lock, which stays with the node while its threads are waiting,
+ * so the lock and the protected data are passed between cores of the same socket.
+ * After Batch local hand-offs the global lock is released for fairness to other nodes.
+ * Both levels are ticket locks, so waiters are served FIFO within the node.
+ * Meets the Lockable requirements.
+ * @tparam Batch The maximum number of consecutive hand-offs within the node.
+ * @tparam MaxNodes The number of node locks, extra nodes share them.
+ */
+template<std::uint32_t Batch = 64, std::size_t MaxNodes = 8>
+class basic_numa_cohort_mutex
+{
+    static_assert(Batch > 0 && MaxNodes > 0, "numa_cohort_mutex requires positive batch and nodes count");
+
+    // The lock of one node, on its own cache line.
+    struct alignas(detail::cache_line_size) cohort
+    {
+        ticket_mutex lock;
+        // Fields below are owned by the holder of the node lock.
+        // Whether the global lock is held by this node.
+        bool global_owned = false;
+        // The number of consecutive hand-offs within the node.
+        std::uint32_t batch = 0;
+    };
+
+  public:
+    basic_numa_cohort_mutex() : topology(detail::numa_topology::instance()) {
+    }
+
+    basic_numa_cohort_mutex(const basic_numa_cohort_mutex &) = delete;
+    basic_numa_cohort_mutex &operator=(const basic_numa_cohort_mutex &) = delete;
+
+    /**
+     * @brief Lock the node lock and then the global one, unless it is inherited from the node neighbour.
+     */
+    void lock() noexcept {
+        const auto node = topology.current_node() % MaxNodes;
+        auto &local = cohorts[node];
+        local.lock.lock();
+        if (!local.global_owned) {
+            global.lock();
+            local.global_owned = true;
+        }
+        owner = node;
+    }
+
+    /**
+     * @brief Try to lock the mutex without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        const auto node = topology.current_node() % MaxNodes;
+        auto &local = cohorts[node];
+        if (!local.lock.try_lock())
+            return false;
+        if (!local.global_owned) {
+            if (!global.try_lock()) {
+                local.lock.unlock();
+                return false;
+            }
+            local.global_owned = true;
+        }
+        owner = node;
+        return true;
+    }
+
+    /**
+     * @brief Pass the lock to the waiter of the same node, or release the global lock.
+     */
+    void unlock() noexcept {
+        auto &local = cohorts[owner];
+        if (local.lock.has_waiters() && ++local.batch < Batch) {
+            local.lock.unlock();
+            return;
+        }
+        local.batch = 0;
+        local.global_owned = false;
+        global.unlock();
+        local.lock.unlock();
+    }
+
+  private:
+    // Member variables
+    // The machine topology.
+    const detail::numa_topology &topology;
+    // The lock passed between nodes.
+    alignas(detail::cache_line_size) ticket_mutex global;
+    // The node of the current owner, the thread may migrate while holding the lock.
+    std::size_t owner = 0;
+    // The node locks.
+    cohort cohorts[MaxNodes];
+};
+
+//! NUMA cohort mutex with the default batch size and nodes count.
+typedef basic_numa_cohort_mutex<> numa_cohort_mutex;
+
+} // end namespace im
+
+#endif //SMARTMUTEX__NUMA_COHORT_MUTEX_H_
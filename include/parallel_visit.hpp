@@ -0,0 +1,231 @@
+// Implementation of the bulk visitation of smart_mutex ranges.
+//
+
+#ifndef SMARTMUTEX__PARALLEL_VISIT_H_
+#define SMARTMUTEX__PARALLEL_VISIT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(SMART_MUTEX_EXECUTION_POLICIES)
+#include <execution>
+#endif
+
+#include "smart_mutex.hpp"
+
+namespace im
+{
+
+namespace detail
+{
+
+template<class P, class = void>
+struct is_execution_policy : std::false_type
+{
+};
+
+#if defined(SMART_MUTEX_EXECUTION_POLICIES)
+template<class P>
+struct is_execution_policy<P, std::enable_if_t<std::is_execution_policy_v<std::decay_t<P>>>> : std::true_type
+{
+};
+#endif
+
+template<class P>
+inline constexpr bool is_execution_policy_v = is_execution_policy<P>::value;
+
+// Visit the element if its lock is free.
+template<class Smart, class Fn>
+bool try_visit(Smart &smart, Fn &fn) {
+    access_for_t<Smart> proxy(smart, std::try_to_lock);
+    if (!proxy)
+        return false;
+    std::invoke(fn, *proxy.operator->());
+    return true;
+}
+
+template<class Smart, class Fn>
+void visit(Smart &smart, Fn &fn) {
+    access_for_t<Smart> proxy(smart);
+    std::invoke(fn, *proxy.operator->());
+}
+
+/**
+ * @brief Visit every element of [first, last), the busy ones are put aside and
+ * revisited after the rest. When the whole round over the busy elements makes no
+ * progress, the first of them is waited for, so the call always completes.
+ */
+template<class It, class Fn>
+void visit_skipping_busy(It first, It last, Fn &fn) {
+    std::vector<It> busy;
+    for (; first != last; ++first) {
+        if (!try_visit(*first, fn))
+            busy.push_back(first);
+    }
+
+    while (!busy.empty()) {
+        auto kept = busy.begin();
+        for (auto it = busy.begin(); it != busy.end(); ++it) {
+            if (!try_visit(**it, fn))
+                *kept++ = *it;
+        }
+        if (kept == busy.end()) {
+            visit(*busy.front(), fn);
+            kept = std::move(std::next(busy.begin()), busy.end(), busy.begin());
+        }
+        busy.erase(kept, busy.end());
+    }
+}
+
+// Split [first, last) into at most count contiguous chunks of equal size.
+template<class It>
+std::vector<std::pair<It, It>> split_range(It first, It last, std::size_t count) {
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    count = std::max<std::size_t>(1, std::min(count, size));
+    std::vector<std::pair<It, It>> chunks;
+    chunks.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto next = std::next(first, static_cast<std::ptrdiff_t>(size / count + (i < size % count ? 1 : 0)));
+        chunks.emplace_back(first, next);
+        first = next;
+    }
+    return chunks;
+}
+
+// The number of chunks per worker, so the workers finishing early take the rest.
+inline constexpr std::size_t chunks_per_worker = 4;
+
+inline std::size_t default_concurrency() noexcept {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // end namespace detail
+
+/**
+ * @brief Visit every smart_mutex of the range by the calling thread, e.g. to aggregate
+ * per-worker statistics. Elements locked by other threads are skipped and revisited
+ * after the rest, so the visitor doesn't convoy behind the busy ones. It blocks only
+ * when all remaining elements stay busy for the whole round.
+ * @param range The range of smart_mutexes, elements of const ranges are visited
+ * under read_access, using <code>std::as_const()</code> for shared locking, and
+ * under write_access otherwise.
+ * @param fn The function called with the reference to every value, holding its lock.
+ * The order of calls is unspecified.
+ */
+template<class Range, class Fn>
+void parallel_visit(Range &&range, Fn &&fn) {
+    using std::begin;
+    using std::end;
+    detail::visit_skipping_busy(begin(range), end(range), fn);
+}
+
+#if defined(SMART_MUTEX_EXECUTION_POLICIES)
+/**
+ * @brief Visit every smart_mutex of the range in parallel with the standard execution
+ * policy. The range is split into chunks, which are visited by the algorithm the same
+ * way as by parallel_visit(range, fn). Like with other standard parallel algorithms,
+ * <code>std::terminate()</code> is called if fn throws. Available if
+ * SMART_MUTEX_EXECUTION_POLICIES is defined before the header is included, because
+ * <code><execution></code> of libstdc++ requires TBB to be linked.
+ * @param range The forward range of smart_mutexes, see parallel_visit(range, fn).
+ * @param fn The function called concurrently with the reference to every value, holding its lock.
+ * @param policy The execution policy, e.g. <code>std::execution::par</code>.
+ */
+template<class Range, class Fn, class Policy, typename = std::enable_if_t<detail::is_execution_policy_v<Policy>>>
+void parallel_visit(Range &&range, Fn &&fn, Policy &&policy) {
+    using std::begin;
+    using std::end;
+    auto chunks = detail::split_range(begin(range), end(range),
+                                      detail::default_concurrency() * detail::chunks_per_worker);
+    std::for_each(std::forward<Policy>(policy), chunks.begin(), chunks.end(), [&fn](const auto &chunk) {
+        detail::visit_skipping_busy(chunk.first, chunk.second, fn);
+    });
+}
+#endif
+
+/**
+ * @brief Visit every smart_mutex of the range in parallel with the thread pool. The
+ * range is split into chunks submitted as separate tasks, which are visited the same
+ * way as by parallel_visit(range, fn), and the call waits for all of them. The first
+ * exception thrown by fn is rethrown after the rest of tasks finish, the values not
+ * visited by the failed task are skipped. If the executor throws, the chunks whose
+ * tasks haven't started yet are cancelled, their tasks return immediately whenever
+ * they run, and the exception is rethrown after the started ones finish.
+ * @param range The forward range of smart_mutexes, see parallel_visit(range, fn).
+ * @param fn The function called concurrently with the reference to every value, holding its lock.
+ * @param executor The callable accepting a nullary copyable task to run it on the pool.
+ * @param concurrency The number of pool threads to split the work for.
+ */
+template<class Range, class Fn, class Executor, typename = std::enable_if_t<!detail::is_execution_policy_v<Executor>>>
+void parallel_visit(Range &&range, Fn &&fn, Executor &&executor,
+                    std::size_t concurrency = detail::default_concurrency()) {
+    using std::begin;
+    using std::end;
+    const auto chunks = detail::split_range(begin(range), end(range),
+                                            std::max<std::size_t>(1, concurrency) * detail::chunks_per_worker);
+
+    // Shared with the tasks, which may outlive the call if the executor fails.
+    struct completion
+    {
+        explicit completion(std::size_t count) : claimed(count), pending(count) {}
+
+        // Set by the task starting the chunk, or by the caller cancelling it.
+        std::vector<std::atomic<bool>> claimed;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t pending;
+        std::exception_ptr error;
+    };
+    const auto state = std::make_shared<completion>(chunks.size());
+
+    try {
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            const auto *task_chunk = &chunks[i];
+            auto *task_fn = &fn;
+            std::invoke(executor, [task_chunk, task_fn, state, i]() {
+                if (state->claimed[i].exchange(true, std::memory_order_acq_rel))
+                    return;
+                std::exception_ptr error;
+                try {
+                    detail::visit_skipping_busy(task_chunk->first, task_chunk->second, *task_fn);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard lock(state->mutex);
+                if (error && !state->error)
+                    state->error = std::move(error);
+                if (--state->pending == 0)
+                    state->done.notify_all();
+            });
+        }
+    } catch (...) {
+        // Whether the executor has run or queued the failed task is unknown, so every
+        // chunk not started yet is cancelled and the started ones are waited for.
+        std::unique_lock lock(state->mutex);
+        for (auto &claimed : state->claimed) {
+            if (!claimed.exchange(true, std::memory_order_acq_rel))
+                --state->pending;
+        }
+        state->done.wait(lock, [&state]() { return state->pending == 0; });
+        throw;
+    }
+
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->pending == 0; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
+} // end namespace im
+
+#endif //SMARTMUTEX__PARALLEL_VISIT_H_
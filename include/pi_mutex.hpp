@@ -0,0 +1,135 @@
+// Implementation of the priority inheritance mutex policy.
+//
+
+#ifndef SMARTMUTEX__PI_MUTEX_H_
+#define SMARTMUTEX__PI_MUTEX_H_
+
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <system_error>
+
+#include <pthread.h>
+
+namespace im
+{
+
+/**
+ * @class pi_mutex
+ * @brief Priority inheritance mutex for real-time threads. The owner of the
+ * POSIX <code>PTHREAD_PRIO_INHERIT</code> mutex temporarily runs with the priority
+ * of the highest priority waiter, so the low priority owner (e.g. the logger)
+ * preempted by medium priority threads can't block the <code>SCHED_FIFO</code>
+ * waiter for the unbounded time. On Linux it is backed by the PI futex, and the
+ * kernel boosts the owner directly. Every contended acquisition enters the kernel,
+ * so it is slower than <code>std::mutex</code> under contention. Errors are reported
+ * by <code>std::system_error</code> like <code>std::mutex</code>. Meets the Lockable
+ * requirements, and the TimedLockable ones where <code>pthread_mutex_timedlock()</code>
+ * is available (not on macOS).
+ */
+class pi_mutex
+{
+  public:
+    //! The native handle type.
+    typedef pthread_mutex_t *native_handle_type;
+
+  public:
+    /**
+     * @brief Initialize the priority inheritance mutex.
+     * @throw std::system_error if priority inheritance isn't supported.
+     */
+    pi_mutex() {
+        pthread_mutexattr_t attr;
+        check(pthread_mutexattr_init(&attr), "pthread_mutexattr_init");
+        int error = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+        if (error == 0)
+            error = pthread_mutex_init(&handle, &attr);
+        pthread_mutexattr_destroy(&attr);
+        check(error, "pi_mutex");
+    }
+
+    ~pi_mutex() {
+        pthread_mutex_destroy(&handle);
+    }
+
+    pi_mutex(const pi_mutex &) = delete;
+    pi_mutex &operator=(const pi_mutex &) = delete;
+
+    /**
+     * @brief Lock the mutex, the owner inherits the priority of the caller while it waits.
+     * @throw std::system_error if the mutex couldn't be locked, e.g. relocked by the owner.
+     */
+    void lock() {
+        check(pthread_mutex_lock(&handle), "pi_mutex::lock");
+    }
+
+    /**
+     * @brief Try to lock the mutex without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        return pthread_mutex_trylock(&handle) == 0;
+    }
+
+#if !defined(__APPLE__)
+    /**
+     * @brief Try to lock the mutex, blocking for the specified timeout at most.
+     * @param timeout The maximum duration to block for.
+     * @return true if the lock was acquired.
+     */
+    template<class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        return try_lock_until(std::chrono::system_clock::now() + timeout);
+    }
+
+    /**
+     * @brief Try to lock the mutex, blocking until the deadline at most.
+     * @param deadline The time point to block until.
+     * @return true if the lock was acquired.
+     */
+    template<class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        // pthread_mutex_timedlock() waits by CLOCK_REALTIME.
+        const auto until = std::chrono::system_clock::now() + (deadline - Clock::now());
+        const auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(until.time_since_epoch());
+        timespec ts;
+        ts.tv_sec = static_cast<std::time_t>(since_epoch.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);
+        const int error = pthread_mutex_timedlock(&handle, &ts);
+        if (error == ETIMEDOUT)
+            return false;
+        check(error, "pi_mutex::try_lock_until");
+        return true;
+    }
+#endif
+
+    /**
+     * @brief Unlock the mutex, the owner gets back its own priority.
+     */
+    void unlock() noexcept {
+        pthread_mutex_unlock(&handle);
+    }
+
+    /**
+     * @brief Get the underlying pthread mutex, e.g. to set its priority ceiling.
+     * @return The pointer to the pthread mutex.
+     */
+    native_handle_type native_handle() noexcept {
+        return &handle;
+    }
+
+  private:
+    static void check(int error, const char *what) {
+        if (error != 0)
+            throw std::system_error(error, std::system_category(), what);
+    }
+
+  private:
+    // Member variables
+    // The pthread mutex with the priority inheritance protocol.
+    pthread_mutex_t handle;
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__PI_MUTEX_H_
@@ -0,0 +1,131 @@
+// Implementation of the smart mutex owning the memory resource of its value.
+//
+
+#ifndef SMARTMUTEX__PMR_SMART_MUTEX_H_
+#define SMARTMUTEX__PMR_SMART_MUTEX_H_
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "smart_mutex.hpp"
+
+namespace im
+{
+
+namespace detail
+{
+
+/**
+ * @brief Base holding the memory resource, so it is constructed before and
+ * destroyed after the value allocated from it.
+ * @tparam Resource The memory resource type.
+ */
+template<class Resource>
+struct resource_holder
+{
+    Resource memory;
+};
+
+} // end namespace detail
+
+/**
+ * @class pmr_smart_mutex
+ * @brief smart_mutex with the value allocated from the private memory resource,
+ * e.g. <code>std::pmr::vector</code> or <code>std::pmr::unordered_map</code>.
+ * Allocations made under the lock come from the arena of this instance instead of
+ * the global heap, so critical sections don't contend on the allocator locks and
+ * their duration is more predictable. The default unsynchronized pool is guarded
+ * by the lock of smart_mutex, i.e. the memory of the value must only be allocated
+ * and freed under write_access. Values moved out of it (e.g. by take()) or
+ * drained with take_all() outlive the lock, use the synchronized Resource for them.
+ * The value keeps the allocator of the resource: update() move-assigns the new value
+ * and the swap with the value of T (also by take_all()) is done by moves, so values
+ * from other resources are copied element-wise into it.
+ * @tparam T The type of the allocator-aware value, using <code>std::pmr::polymorphic_allocator</code>.
+ * @tparam Mutex The Mutex type, see smart_mutex.
+ * @tparam Resource The memory resource type owned by the instance.
+ * @tparam Layout The memory layout, see smart_mutex.
+ */
+template<class T, class Mutex = std::mutex, class Resource = std::pmr::unsynchronized_pool_resource,
+         class Layout = layout::packed>
+class pmr_smart_mutex : private detail::resource_holder<Resource>, public smart_mutex<T, Mutex, Layout>
+{
+    static_assert(std::is_base_of_v<std::pmr::memory_resource, Resource>,
+                  "pmr_smart_mutex requires std::pmr::memory_resource");
+    static_assert(std::uses_allocator_v<T, std::pmr::polymorphic_allocator<std::byte>>,
+                  "pmr_smart_mutex requires the value using std::pmr::polymorphic_allocator");
+
+    typedef detail::resource_holder<Resource> holder_type;
+
+  public:
+    //! A type of the underlying smart_mutex.
+    typedef smart_mutex<T, Mutex, Layout> base_type;
+
+  public:
+    // Construction/Destruction
+    /**
+     * @brief  Create pmr_smart_mutex with the default constructed resource and the value
+     * constructed from the forwarded arguments with the allocator of the resource.
+     * The value passed as the argument is copied or moved element-wise into the resource.
+     * @tparam Args Types of elements passed to the underlying value constructor.
+     * @param args Elements passed to the underlying value constructor.
+     */
+    template<typename ...Args, typename = std::enable_if_t<!detail::is_reserved_ctor_args_v<pmr_smart_mutex, Args...>>>
+    explicit pmr_smart_mutex(Args &&...args)
+        : holder_type(), base_type(std::allocator_arg, allocator_of(this->memory), std::forward<Args>(args)...) {
+    }
+
+    /**
+     * @brief  Create pmr_smart_mutex with the resource constructed from its options
+     * (e.g. <code>std::pmr::pool_options</code> or the upstream resource) and the value
+     * constructed from the forwarded arguments with the allocator of the resource.
+     * @tparam Options The type of the resource constructor argument.
+     * @tparam Args Types of elements passed to the underlying value constructor.
+     * @param options The resource constructor argument.
+     * @param args Elements passed to the underlying value constructor.
+     */
+    template<class Options, typename ...Args>
+    pmr_smart_mutex(std::in_place_type_t<Resource>, Options &&options, Args &&...args)
+        : holder_type{Resource(std::forward<Options>(options))},
+          base_type(std::allocator_arg, allocator_of(this->memory), std::forward<Args>(args)...) {
+    }
+
+    // The value refers to the resource of this instance.
+    pmr_smart_mutex(const pmr_smart_mutex &) = delete;
+    pmr_smart_mutex &operator=(const pmr_smart_mutex &) = delete;
+
+    /**
+     * @brief Get the memory resource of the value, e.g. to allocate the spare for
+     * take_all() from it. It is thread safe only if Resource is synchronized.
+     * @return The resource reference.
+     */
+    Resource &resource() noexcept {
+        return this->memory;
+    }
+
+    /**
+     * @brief Get the allocator of the value.
+     * @return The allocator using the resource of this instance.
+     */
+    std::pmr::polymorphic_allocator<std::byte> allocator() noexcept {
+        return allocator_of(this->memory);
+    }
+
+    // Swapping containers with different resources is undefined, swap the contents of
+    // the value with the one allocated from resource() instead.
+    friend void swap(pmr_smart_mutex &, pmr_smart_mutex &) = delete;
+
+  private:
+    // Static, so it is safe to call before the base smart_mutex is constructed.
+    static std::pmr::polymorphic_allocator<std::byte> allocator_of(Resource &memory) noexcept {
+        return std::pmr::polymorphic_allocator<std::byte>(&memory);
+    }
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__PMR_SMART_MUTEX_H_
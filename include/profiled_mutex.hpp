@@ -0,0 +1,314 @@
+// Implementation of the lock contention profiling mutex policy.
+//
+
+#ifndef SMARTMUTEX__PROFILED_MUTEX_H_
+#define SMARTMUTEX__PROFILED_MUTEX_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @struct lock_profile
+ * @brief Snapshot of contention counters of one profiled_mutex.
+ */
+struct lock_profile
+{
+    //! Address of the profiled mutex, the same as of the owning smart_mutex with the packed layout.
+    const void *mutex = nullptr;
+    //! Number of exclusive acquisitions.
+    std::uint64_t acquisitions = 0;
+    //! Number of exclusive acquisitions which had to wait.
+    std::uint64_t contended = 0;
+    //! Total time spent waiting for the exclusive lock.
+    std::uint64_t wait_ns = 0;
+    //! Total time the exclusive lock was held.
+    std::uint64_t hold_ns = 0;
+    //! Longest wait for the exclusive lock.
+    std::uint64_t max_wait_ns = 0;
+    //! Longest exclusive lock hold.
+    std::uint64_t max_hold_ns = 0;
+    //! Number of shared acquisitions.
+    std::uint64_t shared_acquisitions = 0;
+    //! Number of shared acquisitions which had to wait.
+    std::uint64_t shared_contended = 0;
+    //! Total time spent waiting for the shared lock.
+    std::uint64_t shared_wait_ns = 0;
+};
+
+namespace detail
+{
+
+/**
+ * @brief Counters of shared acquisitions, written concurrently by readers. They are
+ * split into stripes on separate cache lines, every thread updates its own stripe,
+ * so profiling doesn't make readers of the lock contend on one counter.
+ */
+struct shared_lock_counters
+{
+    // The number of stripes, threads beyond it share them.
+    static constexpr std::size_t stripes = 8;
+
+    struct alignas(cache_line_size) stripe
+    {
+        std::atomic<std::uint64_t> acquisitions{0};
+        std::atomic<std::uint64_t> contended{0};
+        std::atomic<std::uint64_t> wait_ticks{0};
+    };
+
+    // The stripe of the calling thread, threads take stripes round-robin.
+    stripe &local() noexcept {
+        static std::atomic<std::size_t> threads{0};
+        thread_local const std::size_t index = threads.fetch_add(1, std::memory_order_relaxed) % stripes;
+        return counters[index];
+    }
+
+    // Sum the counter over all stripes.
+    template<class Counter>
+    std::uint64_t sum(Counter counter) const noexcept {
+        std::uint64_t total = 0;
+        for (const auto &part : counters)
+            total += (part.*counter).load(std::memory_order_relaxed);
+        return total;
+    }
+
+    std::array<stripe, stripes> counters;
+};
+
+/**
+ * @brief Counters of the profiled_mutex linked into the global registry.
+ * Exclusive counters are only written by the thread owning the lock they measure,
+ * so updates are plain relaxed stores without read-modify-write on shared memory.
+ */
+struct lock_counters
+{
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static void max(std::atomic<std::uint64_t> &counter, std::uint64_t value) noexcept {
+        if (value > counter.load(std::memory_order_relaxed))
+            counter.store(value, std::memory_order_relaxed);
+    }
+
+    lock_profile snapshot(double ticks_per_ns) const noexcept {
+        const auto ns = [ticks_per_ns](const std::atomic<std::uint64_t> &ticks) {
+            return static_cast<std::uint64_t>(static_cast<double>(ticks.load(std::memory_order_relaxed)) / ticks_per_ns);
+        };
+
+        lock_profile profile;
+        profile.mutex = owner;
+        profile.acquisitions = acquisitions.load(std::memory_order_relaxed);
+        profile.contended = contended.load(std::memory_order_relaxed);
+        profile.wait_ns = ns(wait_ticks);
+        profile.hold_ns = ns(hold_ticks);
+        profile.max_wait_ns = ns(max_wait_ticks);
+        profile.max_hold_ns = ns(max_hold_ticks);
+        profile.shared_acquisitions = shared.sum(&shared_lock_counters::stripe::acquisitions);
+        profile.shared_contended = shared.sum(&shared_lock_counters::stripe::contended);
+        profile.shared_wait_ns = static_cast<std::uint64_t>(
+            static_cast<double>(shared.sum(&shared_lock_counters::stripe::wait_ticks)) / ticks_per_ns);
+        return profile;
+    }
+
+    std::atomic<std::uint64_t> acquisitions{0};
+    std::atomic<std::uint64_t> contended{0};
+    std::atomic<std::uint64_t> wait_ticks{0};
+    std::atomic<std::uint64_t> hold_ticks{0};
+    std::atomic<std::uint64_t> max_wait_ticks{0};
+    std::atomic<std::uint64_t> max_hold_ticks{0};
+    shared_lock_counters shared;
+
+    // The address of the owning mutex.
+    const void *owner = nullptr;
+    // Intrusive registry list links.
+    lock_counters *prev = nullptr;
+    lock_counters *next = nullptr;
+};
+
+/**
+ * @brief Global intrusive list of all alive profiled_mutexes.
+ */
+class lock_registry
+{
+  public:
+    // Never destroyed, static profiled_mutexes may outlive any other static object.
+    static lock_registry &instance() {
+        static auto *registry = new lock_registry;
+        return *registry;
+    }
+
+    void add(lock_counters &counters) {
+        std::lock_guard lock(mutex);
+        counters.next = head;
+        if (head)
+            head->prev = &counters;
+        head = &counters;
+    }
+
+    void remove(lock_counters &counters) {
+        std::lock_guard lock(mutex);
+        if (counters.prev)
+            counters.prev->next = counters.next;
+        else
+            head = counters.next;
+        if (counters.next)
+            counters.next->prev = counters.prev;
+    }
+
+    std::vector<lock_profile> snapshot() {
+        const auto rate = cpu_ticks_per_nanosecond();
+        std::vector<lock_profile> profiles;
+        std::lock_guard lock(mutex);
+        for (auto *counters = head; counters; counters = counters->next)
+            profiles.push_back(counters->snapshot(rate));
+        return profiles;
+    }
+
+  private:
+    std::mutex mutex;
+    lock_counters *head = nullptr;
+};
+
+} // end namespace detail
+
+/**
+ * @class profiled_mutex
+ * @brief Mutex policy wrapper recording acquisition count, contended acquisition
+ * count, wait time and hold time of the underlying mutex. Time is measured with the
+ * CPU tick counter, counters are updated by the lock owner only, so the overhead
+ * is two tick reads per acquisition.
+ * @tparam Mutex The profiled Mutex type. SharedLockable mutexes stay SharedLockable,
+ * shared acquisitions count wait time only, into per-thread stripes of counters.
+ */
+template<class Mutex = std::mutex>
+class profiled_mutex
+{
+  public:
+    profiled_mutex() {
+        counters.owner = this;
+        detail::lock_registry::instance().add(counters);
+    }
+
+    ~profiled_mutex() {
+        detail::lock_registry::instance().remove(counters);
+    }
+
+    profiled_mutex(const profiled_mutex &) = delete;
+    profiled_mutex &operator=(const profiled_mutex &) = delete;
+
+    /**
+     * @brief Lock the underlying mutex, record wait time if it was busy.
+     */
+    void lock() {
+        if (!mutex.try_lock()) {
+            const auto start = detail::cpu_ticks();
+            mutex.lock();
+            acquired = detail::cpu_ticks();
+            const auto wait = acquired - start;
+            detail::lock_counters::add(counters.contended, 1);
+            detail::lock_counters::add(counters.wait_ticks, wait);
+            detail::lock_counters::max(counters.max_wait_ticks, wait);
+        } else {
+            acquired = detail::cpu_ticks();
+        }
+        detail::lock_counters::add(counters.acquisitions, 1);
+    }
+
+    /**
+     * @brief Try to lock the underlying mutex.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() {
+        if (!mutex.try_lock())
+            return false;
+        acquired = detail::cpu_ticks();
+        detail::lock_counters::add(counters.acquisitions, 1);
+        return true;
+    }
+
+    /**
+     * @brief Record hold time and unlock the underlying mutex.
+     */
+    void unlock() {
+        const auto hold = detail::cpu_ticks() - acquired;
+        detail::lock_counters::add(counters.hold_ticks, hold);
+        detail::lock_counters::max(counters.max_hold_ticks, hold);
+        mutex.unlock();
+    }
+
+    /**
+     * @brief Lock the underlying mutex in shared mode, record wait time if it was busy.
+     */
+    template<class M = Mutex>
+    auto lock_shared() -> decltype(std::declval<M &>().lock_shared()) {
+        auto &stripe = counters.shared.local();
+        if (!mutex.try_lock_shared()) {
+            const auto start = detail::cpu_ticks();
+            mutex.lock_shared();
+            stripe.contended.fetch_add(1, std::memory_order_relaxed);
+            stripe.wait_ticks.fetch_add(detail::cpu_ticks() - start, std::memory_order_relaxed);
+        }
+        stripe.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Try to lock the underlying mutex in shared mode.
+     * @return true if the lock was acquired.
+     */
+    template<class M = Mutex>
+    auto try_lock_shared() -> decltype(std::declval<M &>().try_lock_shared()) {
+        if (!mutex.try_lock_shared())
+            return false;
+        counters.shared.local().acquisitions.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Unlock the underlying mutex in shared mode.
+     */
+    template<class M = Mutex>
+    auto unlock_shared() -> decltype(std::declval<M &>().unlock_shared()) {
+        mutex.unlock_shared();
+    }
+
+    /**
+     * @brief Get the snapshot of this mutex counters.
+     * @return Counters snapshot.
+     */
+    lock_profile profile() const {
+        return counters.snapshot(detail::cpu_ticks_per_nanosecond());
+    }
+
+  private:
+    // Member variables
+    // The profiled mutex.
+    Mutex mutex;
+    // The tick of the last exclusive acquisition.
+    std::uint64_t acquired = 0;
+    // The counters linked into the registry.
+    detail::lock_counters counters;
+};
+
+/**
+ * @brief Get the snapshot of counters of all alive profiled_mutexes, e.g. for export
+ * to the monitoring system. Counters are read without locking, so one snapshot
+ * may be slightly inconsistent across fields.
+ * @return Counters snapshots.
+ */
+inline std::vector<lock_profile> lock_profiles() {
+    return detail::lock_registry::instance().snapshot();
+}
+
+} // end namespace im
+
+#endif //SMARTMUTEX__PROFILED_MUTEX_H_
@@ -0,0 +1,151 @@
+// Implementation of the sharded smart mutex map.
+//
+
+#ifndef SMARTMUTEX__SHARDED_SMART_MUTEX_H_
+#define SMARTMUTEX__SHARDED_SMART_MUTEX_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "smart_mutex.hpp"
+
+namespace im
+{
+
+/**
+ * @class sharded_smart_mutex
+ * @brief Hash map split into N independently locked shards. Each key belongs
+ * to exactly one shard, so operations on keys from different shards don't
+ * contend with each other.
+ * @tparam K The type of the map key.
+ * @tparam V The type of the mapped value.
+ * @tparam N The number of shards.
+ * @tparam Hash The hash function used both for shard selection and inside shards.
+ * @tparam Mutex The Mutex type of every shard, see smart_mutex.
+ */
+template<class K, class V, std::size_t N = 16, class Hash = std::hash<K>, class Mutex = std::mutex>
+class sharded_smart_mutex
+{
+    static_assert(N > 0, "sharded_smart_mutex requires at least one shard");
+
+  public:
+    // Container specific types
+    //! A type of the map stored in every shard.
+    typedef std::unordered_map<K, V, Hash> map_type;
+    //! A type of the shard, padded to avoid false sharing between neighbours.
+    typedef padded_smart_mutex<map_type, Mutex> shard_type;
+    //! A type representing the write access to the shard in critical section.
+    typedef typename shard_type::write_access write_access;
+    //! A type representing the read access to the shard in critical section.
+    typedef typename shard_type::read_access read_access;
+
+  public:
+    // Construction/Destruction
+    sharded_smart_mutex() = default;
+
+    sharded_smart_mutex(const sharded_smart_mutex &) = delete;
+    sharded_smart_mutex &operator=(const sharded_smart_mutex &) = delete;
+
+    /**
+     * @brief The number of shards.
+     * @return Shards count.
+     */
+    static constexpr std::size_t shard_count() noexcept { return N; }
+
+    // Element access
+    /**
+     * @brief Get the shard owning the key.
+     * @param key The key to look up.
+     * @return The shard reference.
+     */
+    shard_type &shard(const K &key) {
+        return shards[index(key)];
+    }
+
+    /**
+     * @brief Get the read only shard owning the key.
+     * @param key The key to look up.
+     * @return The shard reference.
+     */
+    const shard_type &shard(const K &key) const {
+        return shards[index(key)];
+    }
+
+    /**
+     * @brief Lock the shard owning the key for writing.
+     * @param key The key to look up.
+     * @return write_access lockable wrapper for the shard map.
+     */
+    write_access write(const K &key) {
+        return write_access(shard(key));
+    }
+
+    /**
+     * @brief Lock the shard owning the key for reading.
+     * @param key The key to look up.
+     * @return read_access lockable wrapper for the shard map.
+     */
+    read_access read(const K &key) const {
+        return read_access(shard(key));
+    }
+
+    // Bulk operations
+    /**
+     * @brief Call the function for every shard map one by one, each under its own write lock.
+     * @param fn The function accepting <code>map_type &</code>.
+     */
+    template<typename Fn>
+    void for_each_shard(Fn &&fn) {
+        for (auto &s : shards) {
+            write_access wa(s);
+            fn(*wa.operator->());
+        }
+    }
+
+    /**
+     * @brief Call the function for every shard map one by one, each under its own read lock.
+     * @param fn The function accepting <code>const map_type &</code>.
+     */
+    template<typename Fn>
+    void for_each_shard(Fn &&fn) const {
+        for (auto &s : shards) {
+            read_access ra(s);
+            fn(*ra.operator->());
+        }
+    }
+
+    /**
+     * @brief Count elements in all shards. The result isn't a consistent
+     * snapshot, since shards are locked one by one.
+     * @return Elements count.
+     */
+    std::size_t size() const {
+        std::size_t count = 0;
+        for_each_shard([&count](const map_type &map) { count += map.size(); });
+        return count;
+    }
+
+  private:
+    // Get the shard index. Hash is remixed, otherwise all keys of the shard
+    // would share the same remainder inside the shard map too.
+    std::size_t index(const K &key) const {
+        const auto h = static_cast<std::uint64_t>(hasher(key)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>((h >> 32) % N);
+    }
+
+  private:
+    // Member variables
+    // The hash function used for shard selection.
+    Hash hasher;
+    // The independently locked shards.
+    std::array<shard_type, N> shards;
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__SHARDED_SMART_MUTEX_H_
@@ -6,46 +6,1020 @@
 #ifndef SMARTMUTEX__SMART_MUTEX_H_
 #define SMARTMUTEX__SMART_MUTEX_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <shared_mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "detail/hardware.hpp"
+#include "detail/lock_order.hpp"
 
 namespace im
 {
 
+namespace layout
+{
+
+/**
+ * @brief Default layout, the mutex and the value are packed together without padding.
+ */
+struct packed
+{
+    static constexpr std::size_t object_alignment = 1;
+    static constexpr std::size_t member_alignment = 1;
+};
+
+/**
+ * @brief Each instance is aligned to its own cache lines, so adjacent
+ * smart_mutexes (e.g. in arrays) don't falsely share them.
+ */
+struct cache_padded
+{
+    static constexpr std::size_t object_alignment = detail::cache_line_size;
+    static constexpr std::size_t member_alignment = 1;
+};
+
+/**
+ * @brief Like cache_padded, but the mutex and the value are also placed on
+ * separate cache lines, so waiters spinning on the mutex don't invalidate the value.
+ */
+struct cache_isolated
+{
+    static constexpr std::size_t object_alignment = detail::cache_line_size;
+    static constexpr std::size_t member_alignment = detail::cache_line_size;
+};
+
+/**
+ * @brief The value is kept in the owned heap allocation, so swapping two smart_mutexes,
+ * moving and exchange() just exchange pointers under the lock instead of moving
+ * the whole value, e.g. large std::array buffers. optimistic_read() is not available,
+ * the allocation it would copy from may be freed by the concurrent exchange().
+ */
+struct indirect
+{
+    static constexpr std::size_t object_alignment = 1;
+    static constexpr std::size_t member_alignment = 1;
+    static constexpr bool indirect_storage = true;
+};
+
+/**
+ * @brief Base layout with the version of the value, bumped by every write like the
+ * seqlock sequence, which is required by cached_read() and optimistic_read() and lets
+ * update() compute the value outside the lock. Without it writes don't pay for the
+ * version, e.g. <code>layout::versioned<layout::cache_padded></code>.
+ * @tparam Base The layout of the mutex and the value.
+ */
+template<class Base = packed>
+struct versioned : Base
+{
+    static constexpr bool versioned_storage = true;
+};
+
+/**
+ * @brief Base layout with the list of threads blocked in wait_write() and wait_read(),
+ * which writes check to wake up the ones whose predicates became true. Without it writes
+ * don't look for waiters, e.g. <code>layout::waitable<layout::versioned<>></code>.
+ * @tparam Base The layout of the mutex and the value.
+ */
+template<class Base = packed>
+struct waitable : Base
+{
+    static constexpr bool waitable_storage = true;
+};
+
+} // end namespace layout
+
+namespace detail
+{
+
+/**
+ * @brief Check if the Mutex type meets the SharedLockable requirements
+ * (provides <code>lock_shared()</code> and <code>unlock_shared()</code>).
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_shared_lockable : std::false_type
+{
+};
+
+template<class M>
+struct is_shared_lockable<M, std::void_t<decltype(std::declval<M &>().lock_shared()),
+                                         decltype(std::declval<M &>().unlock_shared())>> : std::true_type
+{
+};
+
+template<class M>
+inline constexpr bool is_shared_lockable_v = is_shared_lockable<M>::value;
+
+/**
+ * @brief Check if the Mutex type meets the TimedLockable requirements
+ * (provides <code>try_lock_for()</code> and <code>try_lock_until()</code>).
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_timed_lockable : std::false_type
+{
+};
+
+template<class M>
+struct is_timed_lockable<M, std::void_t<decltype(std::declval<M &>().try_lock_for(std::chrono::seconds())),
+                                        decltype(std::declval<M &>().try_lock_until(
+                                            std::chrono::steady_clock::now()))>> : std::true_type
+{
+};
+
+template<class M>
+inline constexpr bool is_timed_lockable_v = is_timed_lockable<M>::value;
+
+/**
+ * @brief Check if the Mutex type meets the SharedTimedLockable requirements
+ * (provides <code>try_lock_shared_for()</code> and <code>try_lock_shared_until()</code>).
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_shared_timed_lockable : std::false_type
+{
+};
+
+template<class M>
+struct is_shared_timed_lockable<M, std::void_t<decltype(std::declval<M &>().try_lock_shared_for(
+                                                   std::chrono::seconds())),
+                                               decltype(std::declval<M &>().try_lock_shared_until(
+                                                   std::chrono::steady_clock::now()))>> : std::true_type
+{
+};
+
+template<class M>
+inline constexpr bool is_shared_timed_lockable_v = is_shared_timed_lockable<M>::value;
+
+/**
+ * @brief Check if the Mutex type supports executing operations on behalf of
+ * other threads (provides <code>combine()</code>, e.g. im::combining_mutex).
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_combining : std::false_type
+{
+};
+
+template<class M>
+struct is_combining<M, std::void_t<decltype(std::declval<M &>().combine(std::declval<void (*)()>()))>>
+    : std::true_type
+{
+};
+
+template<class M>
+inline constexpr bool is_combining_v = is_combining<M>::value;
+
+/**
+ * @brief Check if the Mutex type could be acquired by coroutines
+ * (provides awaitable <code>lock_async()</code>, e.g. im::async_mutex).
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_async_lockable : std::false_type
+{
+};
+
+template<class M>
+struct is_async_lockable<M, std::void_t<decltype(std::declval<M &>().lock_async())>> : std::true_type
+{
+};
+
+template<class M>
+inline constexpr bool is_async_lockable_v = is_async_lockable<M>::value;
+
+/**
+ * @brief Check if the Mutex type supports the upgrade ownership (provides
+ * <code>lock_upgrade()</code>, <code>try_lock_upgrade()</code>, <code>unlock_upgrade()</code>
+ * and <code>unlock_upgrade_and_lock()</code>, e.g. im::upgrade_mutex).
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_upgrade_lockable : std::false_type
+{
+};
+
+template<class M>
+struct is_upgrade_lockable<M, std::void_t<decltype(std::declval<M &>().lock_upgrade()),
+                                          decltype(std::declval<M &>().try_lock_upgrade()),
+                                          decltype(std::declval<M &>().unlock_upgrade()),
+                                          decltype(std::declval<M &>().unlock_upgrade_and_lock())>>
+    : std::true_type
+{
+};
+
+template<class M>
+inline constexpr bool is_upgrade_lockable_v = is_upgrade_lockable<M>::value;
+
+/**
+ * @brief Awaitable adapter producing the access proxy, which adopts the lock
+ * acquired by the awaitable of the Mutex.
+ * @tparam Access The access proxy type.
+ * @tparam Smart The smart_mutex type.
+ * @tparam Awaiter The lock awaitable type of the Mutex.
+ */
+template<class Access, class Smart, class Awaiter>
+struct access_awaiter
+{
+    bool await_ready() { return awaiter.await_ready(); }
+
+    template<class Handle>
+    auto await_suspend(Handle handle) { return awaiter.await_suspend(handle); }
+
+    Access await_resume() {
+        awaiter.await_resume();
+        return Access(smart, std::adopt_lock);
+    }
+
+    const Smart &smart;
+    Awaiter awaiter;
+};
+
+/**
+ * @brief Check if the arguments are reserved for dedicated constructors and must not be
+ * matched by the forwarding one, i.e. the first one is the object itself or the tag.
+ * @tparam Self The type of constructed object.
+ * @tparam Args The types of constructor arguments.
+ */
+template<class Self, class ...Args>
+struct is_reserved_ctor_args : std::false_type
+{
+};
+
+template<class Self, class First, class ...Args>
+struct is_reserved_ctor_args<Self, First, Args...>
+    : std::disjunction<std::is_same<std::decay_t<First>, Self>, std::is_same<std::decay_t<First>, std::in_place_t>,
+                       std::is_same<std::decay_t<First>, std::allocator_arg_t>>
+{
+};
+
+template<class Self, class ...Args>
+inline constexpr bool is_reserved_ctor_args_v = is_reserved_ctor_args<Self, Args...>::value;
+
+/**
+ * @brief Check if the type could be stored in <code>std::atomic</code>, which is
+ * always lock-free (e.g. enums, integers, pointers and small trivial structs).
+ * @tparam T The type to check.
+ */
+template<class T, class = void>
+struct is_lock_free_atomic : std::false_type
+{
+};
+
+template<class T>
+struct is_lock_free_atomic<T, std::enable_if_t<std::is_trivially_copyable_v<T> && std::is_copy_constructible_v<T> &&
+                                               std::is_move_constructible_v<T> && std::is_copy_assignable_v<T> &&
+                                               std::is_move_assignable_v<T> && !std::is_const_v<T>>>
+    : std::bool_constant<std::atomic<T>::is_always_lock_free>
+{
+};
+
+template<class T>
+inline constexpr bool is_lock_free_atomic_v = is_lock_free_atomic<T>::value;
+
+/**
+ * @brief Check if the type could be emptied keeping its storage, i.e. provides
+ * <code>clear()</code> like standard containers.
+ * @tparam T The type to check.
+ */
+template<class T, class = void>
+struct is_clearable : std::false_type
+{
+};
+
+template<class T>
+struct is_clearable<T, std::void_t<decltype(std::declval<T &>().clear())>> : std::true_type
+{
+};
+
+template<class T>
+inline constexpr bool is_clearable_v = is_clearable<T>::value;
+
+/**
+ * @brief Copy the trivially copyable value, which may be written concurrently by the
+ * lock holder, with relaxed atomic loads of words of its alignment. The copy may be
+ * torn and is used only if the version validates it afterwards, like in smart_seqlock.
+ * @param to The storage of the copy, aligned as T.
+ * @param from The value to copy.
+ */
+template<class T>
+void racy_copy(unsigned char *to, const T &from) noexcept {
+    using word_type = std::conditional_t<
+        (alignof(T) >= 8), std::uint64_t,
+        std::conditional_t<(alignof(T) >= 4), std::uint32_t,
+                           std::conditional_t<(alignof(T) >= 2), std::uint16_t, std::uint8_t>>>;
+#if defined(__GNUC__) || defined(__clang__)
+    const auto *words = reinterpret_cast<const word_type *>(&from);
+    for (std::size_t i = 0; i < sizeof(T) / sizeof(word_type); ++i) {
+        const word_type word = __atomic_load_n(words + i, __ATOMIC_RELAXED);
+        std::memcpy(to + i * sizeof(word_type), &word, sizeof(word_type));
+    }
+#else
+    std::memcpy(to, &from, sizeof(T));
+#endif
+}
+
+/**
+ * @brief Get the initial version of the new smart_mutex. Every instance starts in its
+ * own range of 2^32 versions, so the replica cached for the destroyed one isn't
+ * mistaken for the replica of other one created at the same address later.
+ * Ranges are taken from the global counter by blocks, once per 1024 instances.
+ * @return The initial version.
+ */
+inline std::uint64_t version_origin() noexcept {
+    constexpr std::uint64_t block = 1024;
+    static std::atomic<std::uint64_t> blocks{0};
+    thread_local std::uint64_t next = 0;
+    thread_local std::uint64_t end = 0;
+    if (next == end) {
+        next = blocks.fetch_add(block, std::memory_order_relaxed);
+        end = next + block;
+    }
+    return next++ << 32;
+}
+
+/**
+ * @brief Version of the protected value, odd while the write is in progress
+ * like the seqlock sequence. Empty and always zero if disabled.
+ * @tparam Enabled Whether the version is stored.
+ */
+template<bool Enabled>
+struct version_counter
+{
+    std::uint64_t load(std::memory_order) const noexcept { return 0; }
+
+    void begin_write() noexcept {
+    }
+
+    void end_write() noexcept {
+    }
+};
+
+template<>
+struct version_counter<true>
+{
+    version_counter() noexcept : value(version_origin()) {
+    }
+
+    std::uint64_t load(std::memory_order order) const noexcept { return value.load(order); }
+
+    // Make the version odd, the stores of the following write can't move before it.
+    void begin_write() noexcept {
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // Make the version even again, after the stores of the write.
+    void end_write() noexcept {
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    std::atomic<std::uint64_t> value;
+};
+
+/**
+ * @brief Check if the Mutex type executes critical sections as hardware transactions
+ * (declares <code>static constexpr bool transactional = true</code>, e.g. im::elided_mutex).
+ * smart_mutex doesn't keep the version for such Mutexes, since writing it in every
+ * critical section would make all of them conflict.
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_transactional : std::false_type
+{
+};
+
+template<class M>
+struct is_transactional<M, std::void_t<decltype(M::transactional)>> : std::bool_constant<M::transactional>
+{
+};
+
+template<class M>
+inline constexpr bool is_transactional_v = is_transactional<M>::value;
+
+/**
+ * @brief Check if the Mutex type doesn't synchronize anything (has the
+ * <code>unsynchronized</code> flag set, e.g. im::null_mutex), so access proxies
+ * don't hold the lock guard and the version and the atomic mirror are not kept.
+ * @tparam M The Mutex type to check.
+ */
+template<class M, class = void>
+struct is_unsynchronized : std::false_type
+{
+};
+
+template<class M>
+struct is_unsynchronized<M, std::void_t<decltype(M::unsynchronized)>> : std::bool_constant<M::unsynchronized>
+{
+};
+
+template<class M>
+inline constexpr bool is_unsynchronized_v = is_unsynchronized<M>::value;
+
+/**
+ * @brief The Mutex type stored by smart_mutex. With SMART_MUTEX_LOCK_ORDER_CHECK defined
+ * it is wrapped by lock_order_checked, which reports inverse acquisition orders of
+ * different instances (see im::set_lock_order_violation_handler()). Async lockable
+ * Mutexes are acquired by coroutines, which may resume on other threads, so they
+ * aren't checked, as are unsynchronized ones.
+ * @tparam M The Mutex type.
+ */
+#if defined(SMART_MUTEX_LOCK_ORDER_CHECK)
+template<class M>
+using checked_mutex_t =
+    std::conditional_t<is_async_lockable_v<M> || is_unsynchronized_v<M>, M, lock_order_checked<M>>;
+#else
+template<class M>
+using checked_mutex_t = M;
+#endif
+
+/**
+ * @brief Empty lock guard of the unsynchronized Mutex, always owns the lock.
+ * Has the interface of <code>std::unique_lock</code> used by access proxies.
+ * @tparam M The Mutex type.
+ */
+template<class M>
+struct null_lock
+{
+    constexpr explicit null_lock(M &) noexcept {
+    }
+
+    template<class Arg>
+    constexpr null_lock(M &, const Arg &) noexcept {
+    }
+
+    constexpr void lock() const noexcept {
+    }
+
+    constexpr bool owns_lock() const noexcept { return true; }
+};
+
+/**
+ * @brief Atomic copy of the protected value, published by writers under the lock
+ * and loaded by readers without it. Empty if disabled.
+ * @tparam T The type of the value.
+ * @tparam Enabled Whether the copy is stored.
+ */
+template<class T, bool Enabled>
+struct atomic_mirror
+{
+    explicit atomic_mirror(const T &) noexcept {
+    }
+};
+
+template<class T>
+struct atomic_mirror<T, true>
+{
+    explicit atomic_mirror(const T &value) noexcept : value(value) {
+    }
+
+    T load() const noexcept { return value.load(std::memory_order_acquire); }
+
+    void store(const T &desired) noexcept { value.store(desired, std::memory_order_release); }
+
+    std::atomic<T> value;
+};
+
+/**
+ * @brief The list of threads waiting for the protected value to satisfy their predicates,
+ * allocated by the first waiter, so smart_mutexes which are never waited on pay one
+ * pointer. Every waiter blocks on its own condition variable, and the writer wakes up
+ * only the ones whose predicates are true for the new value. Empty if disabled.
+ * @tparam Condition The condition variable type.
+ * @tparam Enabled Whether waiting is supported.
+ */
+template<class Condition, bool Enabled>
+struct wait_list
+{
+    void notify() const noexcept {
+    }
+};
+
+template<class Condition>
+struct wait_list<Condition, true>
+{
+    wait_list() noexcept = default;
+
+    ~wait_list() {
+        delete state.load(std::memory_order_relaxed);
+    }
+
+    wait_list(const wait_list &) = delete;
+    wait_list &operator=(const wait_list &) = delete;
+
+    // Block on the lock until pred() is true, the lock has to be held by the caller.
+    template<class Lock, class Pred>
+    void wait(Lock &lock, Pred &pred) {
+        while (!pred()) {
+            waiter node(pred);
+            const enqueued scope{get(), node};
+            node.condition.wait(lock, [&node]() { return node.ready; });
+        }
+    }
+
+    template<class Lock, class Clock, class Duration, class Pred>
+    bool wait_until(Lock &lock, const std::chrono::time_point<Clock, Duration> &deadline, Pred &pred) {
+        while (!pred()) {
+            waiter node(pred);
+            const enqueued scope{get(), node};
+            if (!node.condition.wait_until(lock, deadline, [&node]() { return node.ready; }))
+                return pred();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Wake up the waiters whose predicates are true after the write, the exclusive
+     * lock has to be held by the caller. It excludes all waiters, so the list is walked
+     * without the guard, and woken waiters can't leave before the lock is released.
+     * The waiter whose predicate throws is woken up to rethrow in its own thread.
+     */
+    void notify() const noexcept {
+        auto *waiters = state.load(std::memory_order_acquire);
+        if (!waiters)
+            return;
+        for (auto *node = waiters->head; node;) {
+            auto *next = node->next;
+            bool satisfied = true;
+            try {
+                satisfied = node->check(node->context);
+            } catch (...) {
+            }
+            if (satisfied) {
+                unlink(*waiters, *node);
+                node->ready = true;
+                node->condition.notify_one();
+            }
+            node = next;
+        }
+    }
+
+  private:
+    // The blocked thread, lives on its stack.
+    struct waiter
+    {
+        template<class Pred>
+        explicit waiter(Pred &pred) noexcept
+            : check([](void *context) -> bool { return (*static_cast<Pred *>(context))(); }), context(&pred) {
+        }
+
+        // Evaluates the predicate of the waiter against the value.
+        bool (*check)(void *);
+        void *context;
+        Condition condition;
+        // Set by the writer which removed the waiter from the list.
+        bool ready = false;
+        waiter *prev = nullptr;
+        waiter *next = nullptr;
+    };
+
+    struct waiters_type
+    {
+        // Readers holding the shared lock enqueue concurrently.
+        std::mutex guard;
+        waiter *head = nullptr;
+    };
+
+    // Keeps the waiter in the list until it is woken up or leaves on timeout.
+    struct enqueued
+    {
+        enqueued(waiters_type &waiters, waiter &node) : waiters(waiters), node(node) {
+            std::lock_guard lock(waiters.guard);
+            node.next = waiters.head;
+            if (waiters.head)
+                waiters.head->prev = &node;
+            waiters.head = &node;
+        }
+
+        ~enqueued() {
+            if (node.ready)
+                return;
+            std::lock_guard lock(waiters.guard);
+            unlink(waiters, node);
+        }
+
+        enqueued(const enqueued &) = delete;
+        enqueued &operator=(const enqueued &) = delete;
+
+        waiters_type &waiters;
+        waiter &node;
+    };
+
+    static void unlink(waiters_type &waiters, waiter &node) noexcept {
+        if (node.prev)
+            node.prev->next = node.next;
+        else
+            waiters.head = node.next;
+        if (node.next)
+            node.next->prev = node.prev;
+    }
+
+    waiters_type &get() {
+        auto *waiters = state.load(std::memory_order_acquire);
+        if (waiters)
+            return *waiters;
+        auto created = std::make_unique<waiters_type>();
+        if (state.compare_exchange_strong(waiters, created.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+            return *created.release();
+        return *waiters;
+    }
+
+    std::atomic<waiters_type *> state{nullptr};
+};
+
+/**
+ * @brief Check if the Layout keeps the value behind the pointer
+ * (declares <code>static constexpr bool indirect_storage = true</code>, e.g. im::layout::indirect).
+ * @tparam L The Layout type to check.
+ */
+template<class L, class = void>
+struct is_indirect_layout : std::false_type
+{
+};
+
+template<class L>
+struct is_indirect_layout<L, std::void_t<decltype(L::indirect_storage)>> : std::bool_constant<L::indirect_storage>
+{
+};
+
+template<class L>
+inline constexpr bool is_indirect_layout_v = is_indirect_layout<L>::value;
+
+/**
+ * @brief Check if the Layout keeps the version of the value
+ * (declares <code>static constexpr bool versioned_storage = true</code>, e.g. im::layout::versioned).
+ * @tparam L The Layout type to check.
+ */
+template<class L, class = void>
+struct is_versioned_layout : std::false_type
+{
+};
+
+template<class L>
+struct is_versioned_layout<L, std::void_t<decltype(L::versioned_storage)>> : std::bool_constant<L::versioned_storage>
+{
+};
+
+template<class L>
+inline constexpr bool is_versioned_layout_v = is_versioned_layout<L>::value;
+
+/**
+ * @brief Check if the Layout lets threads wait for the value
+ * (declares <code>static constexpr bool waitable_storage = true</code>, see layout::waitable).
+ * @tparam L The Layout type to check.
+ */
+template<class L, class = void>
+struct is_waitable_layout : std::false_type
+{
+};
+
+template<class L>
+struct is_waitable_layout<L, std::void_t<decltype(L::waitable_storage)>> : std::bool_constant<L::waitable_storage>
+{
+};
+
+template<class L>
+inline constexpr bool is_waitable_layout_v = is_waitable_layout<L>::value;
+
+/**
+ * @brief Construct the value with the allocator by the uses-allocator construction rules:
+ * the allocator is passed after <code>std::allocator_arg</code> or as the last argument,
+ * or is ignored if T doesn't use it.
+ * @tparam T The type of the value.
+ * @param alloc The allocator.
+ * @param args Elements passed to the value constructor.
+ * @return The constructed value.
+ */
+template<class T, class Alloc, class ...Args>
+T make_using_allocator(const Alloc &alloc, Args &&...args) {
+    if constexpr (!std::uses_allocator_v<T, Alloc>) {
+        return T(std::forward<Args>(args)...);
+    } else if constexpr (std::is_constructible_v<T, std::allocator_arg_t, const Alloc &, Args...>) {
+        return T(std::allocator_arg, alloc, std::forward<Args>(args)...);
+    } else {
+        static_assert(std::is_constructible_v<T, Args..., const Alloc &>,
+                      "T uses the allocator, but isn't constructible with it");
+        return T(std::forward<Args>(args)..., alloc);
+    }
+}
+
+/**
+ * @brief Check if swapping two values of the allocator-aware type is undefined unless
+ * their allocators are equal, i.e. the allocator neither propagates on swap nor is
+ * always equal (e.g. <code>std::pmr::polymorphic_allocator</code>).
+ * @tparam T The type to check.
+ */
+template<class T, class = void>
+struct is_swap_bound_to_allocator : std::false_type
+{
+};
+
+template<class T>
+struct is_swap_bound_to_allocator<T, std::void_t<typename T::allocator_type>>
+    : std::bool_constant<!std::allocator_traits<typename T::allocator_type>::propagate_on_container_swap::value &&
+                         !std::allocator_traits<typename T::allocator_type>::is_always_equal::value>
+{
+};
+
+template<class T>
+inline constexpr bool is_swap_bound_to_allocator_v = is_swap_bound_to_allocator<T>::value;
+
+/**
+ * @brief Swap the contents of two values. Values bound to different allocators are
+ * swapped by moves instead, which copy the elements if the allocators differ, so
+ * each value keeps its allocator.
+ */
+template<class T>
+void swap_values(T &lhs, T &rhs) noexcept(!is_swap_bound_to_allocator_v<T>) {
+    if constexpr (is_swap_bound_to_allocator_v<T>) {
+        T previous(std::move(lhs));
+        lhs = std::move(rhs);
+        rhs = std::move(previous);
+    } else {
+        using std::swap;
+        swap(lhs, rhs);
+    }
+}
+
+/**
+ * @brief Put the desired value in place of the stored one. The replaced value is
+ * left in desired, to be destroyed by the caller after unlocking, unless the value
+ * is bound to its allocator. Then the desired one is move-assigned, so the elements
+ * are moved into the allocator of the stored value and the replaced ones are
+ * destroyed in place.
+ */
+template<class T>
+void replace_value(T &stored, T &desired) {
+    if constexpr (is_swap_bound_to_allocator_v<T>) {
+        stored = std::move(desired);
+    } else {
+        using std::swap;
+        swap(stored, desired);
+    }
+}
+
+// Tag of the storage constructor initializing the value with the result of the factory.
+struct factory_construct_t
+{
+    explicit factory_construct_t() = default;
+};
+
+/**
+ * @brief Storage of the value protected by smart_mutex, inline or behind the owned pointer.
+ * @tparam T The type of the value.
+ * @tparam Indirect Whether the value is allocated on the heap.
+ */
+template<class T, bool Indirect>
+struct value_storage
+{
+    template<typename ...Args>
+    explicit value_storage(Args &&...args) : value(std::forward<Args>(args)...) {
+    }
+
+    // The returned prvalue initializes the value directly, T doesn't have to be movable.
+    template<class Factory>
+    value_storage(factory_construct_t, Factory &&factory) : value(std::forward<Factory>(factory)()) {
+    }
+
+    value_storage(value_storage &&other) : value(std::move(other.value)) {
+    }
+
+    value_storage &operator=(value_storage &&other) {
+        value = std::move(other.value);
+        return *this;
+    }
+
+    void swap(value_storage &other) noexcept(!is_swap_bound_to_allocator_v<T>) {
+        swap_values(value, other.value);
+    }
+
+    T &get() noexcept { return value; }
+
+    const T &get() const noexcept { return value; }
+
+    T value;
+};
+
+template<class T>
+struct value_storage<T, true>
+{
+    template<typename ...Args>
+    explicit value_storage(Args &&...args) : ptr(std::make_unique<T>(std::forward<Args>(args)...)) {
+    }
+
+    template<class Factory>
+    value_storage(factory_construct_t, Factory &&factory) : ptr(new T(std::forward<Factory>(factory)())) {
+    }
+
+    // Steal the pointer, other gets the default constructed value if possible,
+    // the value is moved otherwise.
+    value_storage(value_storage &&other) {
+        if constexpr (std::is_default_constructible_v<T>)
+            ptr = std::exchange(other.ptr, std::make_unique<T>());
+        else
+            ptr = std::make_unique<T>(std::move(*other.ptr));
+    }
+
+    // Exchange pointers, other gets the previous value.
+    value_storage &operator=(value_storage &&other) noexcept {
+        ptr.swap(other.ptr);
+        return *this;
+    }
+
+    void swap(value_storage &other) noexcept {
+        ptr.swap(other.ptr);
+    }
+
+    T &get() noexcept { return *ptr; }
+
+    const T &get() const noexcept { return *ptr; }
+
+    // Never null.
+    std::unique_ptr<T> ptr;
+};
+
+} // end namespace detail
+
 /**
  * @class smart_mutex
  * @brief Smart mutex - basic lockable object wrapper for concurrency.
  * @tparam T The type of the element stored in the smart_mutex.
  * @tparam Mutex The Mutex type used for wrapped data protection from being
  * simultaneously accessed by multiple threads. It has to meet the
- * BasicLockable requirements imposed by STL.
+ * BasicLockable requirements imposed by STL. If it also meets the SharedLockable
+ * requirements (e.g. <code>std::shared_mutex</code>), read only access is done
+ * under the shared lock, so readers don't block each other.
+ * @tparam Layout The memory layout policy of the mutex and the value (see im::layout).
+ *
+ * If std::atomic<T> is always lock-free (e.g. enums and integers), the value is
+ * also mirrored into the atomic, which is updated at the end of every write.
+ * Copying out with operator T() and comparisons are then served by atomic loads
+ * without locking the mutex.
+ *
+ * With layout::versioned every write also bumps the version of the value, which is
+ * odd while the write is in progress like in a seqlock. It lets cached_read() serve
+ * rarely changed values from the per-thread replica and optimistic_read() run without
+ * locking.
+ *
+ * With layout::waitable writes also wake up threads blocked in wait_write() and
+ * wait_read() once the value satisfies their predicates.
  */
-template<class T, class Mutex = std::mutex>
+template<class T, class Mutex = std::mutex, class Layout = layout::packed>
 class smart_mutex
 {
+    // The Mutex used by the instance, wrapped to check the lock order if enabled.
+    using mutex_type = detail::checked_mutex_t<Mutex>;
+
+    // The lock type used for read only access to underlying data.
+    using read_lock = std::conditional_t<detail::is_shared_lockable_v<mutex_type>,
+                                         std::shared_lock<mutex_type>,
+                                         std::unique_lock<mutex_type>>;
+
+    // Whether the Mutex is a no-op, e.g. for single threaded use.
+    static constexpr bool unsynchronized = detail::is_unsynchronized_v<Mutex>;
+    // Whether operator T() and comparisons load the atomic mirror instead of locking.
+    static constexpr bool lock_free_reads = detail::is_lock_free_atomic_v<T> && !unsynchronized;
+    // Whether writes bump the version used by cached_read() and optimistic_read().
+    static constexpr bool versioned =
+        detail::is_versioned_layout_v<Layout> && !detail::is_transactional_v<Mutex> && !unsynchronized;
+    // Whether writes wake up threads blocked in wait_write() and wait_read().
+    static constexpr bool waitable = detail::is_waitable_layout_v<Layout> && !unsynchronized;
+    // Whether the value is kept behind the owned pointer.
+    static constexpr bool indirect = detail::is_indirect_layout_v<Layout>;
+    // The condition variable of wait_write() and wait_read(), the native one for std::mutex.
+    using condition_type = std::conditional_t<std::is_same_v<mutex_type, std::mutex>,
+                                              std::condition_variable,
+                                              std::condition_variable_any>;
+
   public:
     // Container specific types
     /**
      * @class access
      * @brief Proxy object for providing access in critical section.
      * @tparam U The type of the element stored in the <code>smart_mutex</code>.
+     * Const qualified U takes the shared lock when Mutex is SharedLockable,
+     * otherwise the exclusive one.
      */
     template<typename U>
     struct access
     {
         explicit access(const smart_mutex &smart) : ref(smart), lg(ref.mutex) {
+            begin();
+        }
+
+        /**
+         * @brief Try to lock without blocking, check the result with owns_lock().
+         */
+        access(const smart_mutex &smart, std::try_to_lock_t tag) : ref(smart), lg(ref.mutex, tag) {
+            begin();
+        }
+
+        /**
+         * @brief Try to lock during the timeout, check the result with owns_lock().
+         * Requires the TimedLockable Mutex.
+         */
+        template<class Rep, class Period>
+        access(const smart_mutex &smart, const std::chrono::duration<Rep, Period> &timeout)
+            : ref(smart), lg(ref.mutex, timeout) {
+            begin();
+        }
+
+        /**
+         * @brief Try to lock until the time point, check the result with owns_lock().
+         * Requires the TimedLockable Mutex.
+         */
+        template<class Clock, class Duration>
+        access(const smart_mutex &smart, const std::chrono::time_point<Clock, Duration> &deadline)
+            : ref(smart), lg(ref.mutex, deadline) {
+            begin();
+        }
+
+        /**
+         * @brief Create proxy without locking, lock it later with lock().
+         */
+        access(const smart_mutex &smart, std::defer_lock_t tag) noexcept : ref(smart), lg(ref.mutex, tag) {
+        }
+
+        /**
+         * @brief Create proxy taking ownership of the lock already held by the caller.
+         */
+        access(const smart_mutex &smart, std::adopt_lock_t tag) noexcept : ref(smart), lg(ref.mutex, tag) {
+            begin();
+        }
+
+        /**
+         * @brief Publish the written value and release the lock.
+         */
+        ~access() {
+            if constexpr (!std::is_const_v<U>) {
+                if (lg.owns_lock())
+                    ref.publish();
+            }
+        }
+
+        access(access &&) noexcept = default;
+
+        /**
+         * @brief Lock the proxy created with std::defer_lock.
+         */
+        void lock() {
+            lg.lock();
+            begin();
         }
 
+        /**
+         * @brief Check if the proxy owns the lock, the underlying value could be
+         * accessed only in this case.
+         * @return true if the lock is owned.
+         */
+        bool owns_lock() const noexcept { return lg.owns_lock(); }
+
+        /**
+         * @brief Check if the proxy owns the lock.
+         * @return true if the lock is owned.
+         */
+        explicit operator bool() const noexcept { return lg.owns_lock(); }
+
         /**
          * @brief Get the underlying type pointer.
          * @return The underlying type pointer.
          */
-        U *operator->() const noexcept { return const_cast<U *>(&ref.value); }
+        U *operator->() const noexcept { return const_cast<U *>(&ref.storage.get()); }
+
+      private:
+        // Mark the value as being written, if the write lock is owned.
+        void begin() noexcept {
+            if constexpr (!std::is_const_v<U>) {
+                if (lg.owns_lock())
+                    ref.begin_write();
+            }
+        }
 
       private:
         // The internal reference to overlying smart_mutex object.
         const smart_mutex &ref;
-        // The internal mutex wrapper with RAII mechanism for owning a mutex.
-        std::lock_guard<Mutex> lg;
+        // The internal mutex wrapper with RAII mechanism for owning a mutex, empty if unsynchronized.
+        SMART_MUTEX_NO_UNIQUE_ADDRESS std::conditional_t<
+            unsynchronized, detail::null_lock<mutex_type>,
+            std::conditional_t<std::is_const_v<U> && detail::is_shared_lockable_v<mutex_type>,
+                               std::shared_lock<mutex_type>,
+                               std::unique_lock<mutex_type>>> lg;
     };
 
     //! A type representing the write access to underlying type in critical section.
@@ -53,6 +1027,78 @@ class smart_mutex
     //! A type representing the read access to underlying type in critical section.
     typedef access<const T> read_access;
 
+    /**
+     * @class upgradeable_access
+     * @brief Proxy object for providing read only access under the upgrade lock,
+     * which coexists with readers, but not with writers and other upgraders.
+     * It could be atomically promoted to write_access, so nothing could change
+     * the value between the check and the modification. Requires the Mutex
+     * supporting upgrade ownership, e.g. im::upgrade_mutex.
+     */
+    struct upgradeable_access
+    {
+        explicit upgradeable_access(smart_mutex &smart) : ref(smart) {
+            static_assert(detail::is_upgrade_lockable_v<mutex_type>, "upgradeable_access requires upgrade lockable Mutex");
+            ref.mutex.lock_upgrade();
+            owns = true;
+        }
+
+        /**
+         * @brief Try to lock without blocking, check the result with owns_lock().
+         */
+        upgradeable_access(smart_mutex &smart, std::try_to_lock_t) : ref(smart) {
+            static_assert(detail::is_upgrade_lockable_v<mutex_type>, "upgradeable_access requires upgrade lockable Mutex");
+            owns = ref.mutex.try_lock_upgrade();
+        }
+
+        upgradeable_access(upgradeable_access &&other) noexcept : ref(other.ref), owns(std::exchange(other.owns, false)) {
+        }
+
+        upgradeable_access(const upgradeable_access &) = delete;
+        upgradeable_access &operator=(const upgradeable_access &) = delete;
+
+        ~upgradeable_access() {
+            if (owns)
+                ref.mutex.unlock_upgrade();
+        }
+
+        /**
+         * @brief Atomically promote the upgrade lock to the exclusive one, waiting
+         * for readers to leave. The proxy doesn't own the lock afterwards.
+         * @return write_access owning the exclusive lock.
+         */
+        write_access upgrade() {
+            ref.mutex.unlock_upgrade_and_lock();
+            owns = false;
+            return write_access(ref, std::adopt_lock);
+        }
+
+        /**
+         * @brief Check if the proxy owns the lock, the underlying value could be
+         * accessed only in this case.
+         * @return true if the lock is owned.
+         */
+        bool owns_lock() const noexcept { return owns; }
+
+        /**
+         * @brief Check if the proxy owns the lock.
+         * @return true if the lock is owned.
+         */
+        explicit operator bool() const noexcept { return owns; }
+
+        /**
+         * @brief Get the underlying type pointer.
+         * @return The read only underlying type pointer.
+         */
+        const T *operator->() const noexcept { return &ref.storage.get(); }
+
+      private:
+        // The internal reference to overlying smart_mutex object.
+        smart_mutex &ref;
+        // Whether the upgrade lock is owned.
+        bool owns = false;
+    };
+
   public:
     // Construction/Destruction
     /**
@@ -60,22 +1106,49 @@ class smart_mutex
      * @tparam Args Types of elements passed to the underlying value constructor.
      * @param args Elements passed to the underlying value constructor.
      */
+    template<typename ...Args, typename = std::enable_if_t<!detail::is_reserved_ctor_args_v<smart_mutex, Args...>>>
+    explicit smart_mutex(Args &&...args) : storage(std::forward<Args>(args)...) {
+    }
+
+    /**
+     * @brief  Create smart_mutex constructing the underlying value in place.
+     * Disambiguates construction from the single argument of smart_mutex type.
+     * @tparam Args Types of elements passed to the underlying value constructor.
+     * @param args Elements passed to the underlying value constructor.
+     */
     template<typename ...Args>
-    explicit smart_mutex(Args ...args) : value(std::forward<Args>(args)...) {
+    explicit smart_mutex(std::in_place_t, Args &&...args) : storage(std::forward<Args>(args)...) {
+    }
+
+    /**
+     * @brief  Create smart_mutex constructing the underlying value with the allocator,
+     * e.g. <code>std::pmr::polymorphic_allocator</code> of the arena, so elements
+     * inserted under the lock don't contend on the global heap. The allocator is passed
+     * by the uses-allocator construction rules and ignored if T doesn't use allocators.
+     * @tparam Alloc The allocator type.
+     * @tparam Args Types of elements passed to the underlying value constructor.
+     * @param alloc The allocator passed to the underlying value constructor.
+     * @param args Elements passed to the underlying value constructor.
+     */
+    template<class Alloc, typename ...Args>
+    smart_mutex(std::allocator_arg_t, const Alloc &alloc, Args &&...args)
+        : storage(detail::factory_construct_t{}, [&] {
+              return detail::make_using_allocator<T>(alloc, std::forward<Args>(args)...);
+          }) {
     }
 
     /**
      * @brief Crate smart_mutex with copying value of underlying type into it.
      * @param other Element of underlying type
      */
-    explicit smart_mutex(const T &other) : value(other) {
+    explicit smart_mutex(const T &other) : storage(other) {
     }
 
     /**
      * @brief Create smart_mutex with moving value of underlying type into it.
      * @param other Element of underlying type
      */
-    explicit smart_mutex(const T &&other) : value(std::move(other)) {
+    explicit smart_mutex(T &&other) : storage(std::move(other)) {
     }
 
     /**
@@ -87,22 +1160,22 @@ class smart_mutex
     // rule of five
     /**
      * The copy constructor.
-     * @brief Creates a copy of the specified circular_buffer.
+     * @brief Creates a copy of the specified smart_mutex, the value is copy
+     * constructed under the read lock of other.
      * @param other The smart_mutex to be copied.
      */
-    smart_mutex(smart_mutex &other) {
-        std::scoped_lock lock(mutex, other.mutex);
-        value = other.value;
+    smart_mutex(const smart_mutex &other) : smart_mutex(other, read_lock(other.mutex)) {
     }
 
     /**
      * The move constructor.
      * @brief Move constructs a smart_mutex from other, leaving other empty.
+     * With the layout::indirect storage the allocation is taken from other, which
+     * gets the new default constructed value.
      * @param other smart_mutex to 'steal' value from.
      */
-    smart_mutex(smart_mutex &&other) noexcept {
-        std::scoped_lock lock(mutex, other.mutex);
-        value = std::move(other.value);
+    smart_mutex(smart_mutex &&other) noexcept
+        : smart_mutex(std::move(other), move_lock{std::unique_lock(other.mutex), write_scope{other}}) {
     }
 
     // Assign methods
@@ -114,19 +1187,22 @@ class smart_mutex
      */
     smart_mutex &operator=(const smart_mutex &other) {
         std::scoped_lock lock(mutex, other.mutex);
-        value = other.value;
+        const write_scope scope{*this};
+        storage.get() = other.storage.get();
         return *this;
     };
 
     /**
      * @brief Move assigns content of other to *this, leaving other empty.
+     * With the layout::indirect storage the values are exchanged instead.
      * C++ compiler with rvalue references support.
      * @param other smart_mutex to 'steal' value from.
      * @return This smart_mutex.
      */
     smart_mutex &operator=(smart_mutex &&other) noexcept {
         std::scoped_lock lock(mutex, other.mutex);
-        value = std::move(other.value);
+        const write_scope scope{*this}, other_scope{other};
+        storage = std::move(other.storage);
         return *this;
     };
 
@@ -136,8 +1212,10 @@ class smart_mutex
      * @return Comparison result.
      */
     bool operator==(const smart_mutex &other) {
+        if constexpr (lock_free_reads)
+            return mirror.load() == other.mirror.load();
         std::scoped_lock lock(mutex, other.mutex);
-        return value == other.value;
+        return storage.get() == other.storage.get();
     }
 
     /**
@@ -148,8 +1226,10 @@ class smart_mutex
      * @return Equal comparison result.
      */
     friend bool operator==(const smart_mutex &lhs, const T &rhs) {
-        std::lock_guard lock(lhs.mutex);
-        return lhs.value == rhs;
+        if constexpr (lock_free_reads)
+            return lhs.mirror.load() == rhs;
+        read_lock lock(lhs.mutex);
+        return lhs.storage.get() == rhs;
     }
 
     /**
@@ -158,8 +1238,10 @@ class smart_mutex
      * @return Unequal comparison result.
      */
     bool operator!=(const smart_mutex &other) {
+        if constexpr (lock_free_reads)
+            return mirror.load() != other.mirror.load();
         std::scoped_lock lock(mutex, other.mutex);
-        return value != other.value;
+        return storage.get() != other.storage.get();
     }
 
     /**
@@ -169,8 +1251,10 @@ class smart_mutex
      * @return Unequal comparison result.
      */
     friend bool operator!=(const smart_mutex &lhs, const T &rhs) {
-        std::lock_guard lock(lhs.mutex);
-        return lhs.value != rhs;
+        if constexpr (lock_free_reads)
+            return lhs.mirror.load() != rhs;
+        read_lock lock(lhs.mutex);
+        return lhs.storage.get() != rhs;
     }
 
     // Element access
@@ -179,8 +1263,80 @@ class smart_mutex
      * @return Underlying value
      */
     operator T() const {
+        if constexpr (lock_free_reads)
+            return mirror.load();
+        read_lock lock(mutex);
+        return storage.get();
+    }
+
+    /**
+     * @brief Replace the underlying value and get the previous one, e.g. to hand over
+     * the filled buffer to the consumer and get the empty one back. With the
+     * layout::indirect storage the new value is allocated before locking and only
+     * pointers are exchanged under the lock, the previous value is moved out after it.
+     * @param desired The new value.
+     * @return The previous value.
+     */
+    T exchange(T &&desired) {
+        if constexpr (indirect) {
+            auto previous = exchange(std::make_unique<T>(std::move(desired)));
+            return std::move(*previous);
+        } else {
+            std::lock_guard lock(mutex);
+            const write_scope scope{*this};
+            return std::exchange(storage.get(), std::move(desired));
+        }
+    }
+
+    /**
+     * @brief Replace the underlying value with the owned one and get the previous
+     * allocation back, only pointers are exchanged under the lock. Requires the
+     * layout::indirect storage.
+     * @param desired The new value, must not be null.
+     * @return The previous value.
+     */
+    std::unique_ptr<T> exchange(std::unique_ptr<T> desired) {
+        static_assert(indirect, "exchange of the owned value requires layout::indirect");
+        assert(desired && "exchange of the null value");
         std::lock_guard lock(mutex);
-        return value;
+        const write_scope scope{*this};
+        storage.ptr.swap(desired);
+        return desired;
+    }
+
+    /**
+     * @brief Move the underlying value out, leaving the default constructed one, e.g.
+     * to process the accumulated events without holding the lock. The new value is
+     * allocated before locking with the layout::indirect storage.
+     * @return The previous value.
+     */
+    T take() {
+        static_assert(std::is_default_constructible_v<T>, "take requires default constructible T");
+        if constexpr (indirect)
+            return std::move(*exchange(std::make_unique<T>()));
+        else
+            return exchange(T{});
+    }
+
+    /**
+     * @brief Drain the underlying value into the spare one in O(1). The spare is
+     * cleared before locking and keeps its capacity (e.g. of <code>std::vector</code>).
+     * Types without <code>clear()</code> are reset to the default value instead.
+     * Then the spare is swapped with the underlying value under the lock. Two buffers
+     * are thus recycled between producers and the consumer without allocations, and
+     * elements of the previous batch are destroyed outside the lock too. Values with
+     * allocators not propagated on swap are swapped by moves, which stay O(1) only
+     * while both allocators are equal.
+     * @param spare The buffer to put in place, receives the drained value.
+     * @return The spare holding the drained value.
+     */
+    T &take_all(T &spare) {
+        if constexpr (detail::is_clearable_v<T>)
+            spare.clear();
+        else
+            spare = T{};
+        swap(*this, spare);
+        return spare;
     }
 
     /**
@@ -199,6 +1355,344 @@ class smart_mutex
         return read_access(*this);
     }
 
+    /**
+     * @brief Try to lock for writing without blocking.
+     * @return write_access wrapper, owning the lock only on success.
+     */
+    write_access try_write() {
+        return write_access(*this, std::try_to_lock);
+    }
+
+    /**
+     * @brief Try to lock for reading without blocking.
+     * @return read_access wrapper, owning the lock only on success.
+     */
+    read_access try_read() const {
+        return read_access(*this, std::try_to_lock);
+    }
+
+    /**
+     * @brief Lock for reading with the option to upgrade to writing, e.g. for
+     * the lookup-miss-then-insert: <code>if (auto ua = sm.upgradeable(); !ua->count(key))
+     * ua.upgrade()->emplace(key, value);</code>. Requires the Mutex supporting
+     * upgrade ownership, e.g. im::upgrade_mutex.
+     * @return upgradeable_access wrapper for underlying value.
+     */
+    upgradeable_access upgradeable() {
+        return upgradeable_access(*this);
+    }
+
+    /**
+     * @brief Try to lock for reading with the option to upgrade without blocking.
+     * @return upgradeable_access wrapper, owning the lock only on success.
+     */
+    upgradeable_access try_upgradeable() {
+        return upgradeable_access(*this, std::try_to_lock);
+    }
+
+    /**
+     * @brief Try to lock for writing, blocking no longer than the timeout.
+     * @param timeout Maximum duration to block for.
+     * @return write_access wrapper, owning the lock only on success.
+     */
+    template<class Rep, class Period>
+    write_access try_write_for(const std::chrono::duration<Rep, Period> &timeout) {
+        static_assert(detail::is_timed_lockable_v<mutex_type>, "try_write_for requires TimedLockable Mutex");
+        return write_access(*this, timeout);
+    }
+
+    /**
+     * @brief Try to lock for writing, blocking until the deadline.
+     * @param deadline Time point to block until.
+     * @return write_access wrapper, owning the lock only on success.
+     */
+    template<class Clock, class Duration>
+    write_access try_write_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        static_assert(detail::is_timed_lockable_v<mutex_type>, "try_write_until requires TimedLockable Mutex");
+        return write_access(*this, deadline);
+    }
+
+    /**
+     * @brief Try to lock for reading, blocking no longer than the timeout.
+     * @param timeout Maximum duration to block for.
+     * @return read_access wrapper, owning the lock only on success.
+     */
+    template<class Rep, class Period>
+    read_access try_read_for(const std::chrono::duration<Rep, Period> &timeout) const {
+        static_assert(detail::is_shared_lockable_v<mutex_type> ? detail::is_shared_timed_lockable_v<mutex_type>
+                                                               : detail::is_timed_lockable_v<mutex_type>,
+                      "try_read_for requires TimedLockable Mutex");
+        return read_access(*this, timeout);
+    }
+
+    /**
+     * @brief Try to lock for reading, blocking until the deadline.
+     * @param deadline Time point to block until.
+     * @return read_access wrapper, owning the lock only on success.
+     */
+    template<class Clock, class Duration>
+    read_access try_read_until(const std::chrono::time_point<Clock, Duration> &deadline) const {
+        static_assert(detail::is_shared_lockable_v<mutex_type> ? detail::is_shared_timed_lockable_v<mutex_type>
+                                                               : detail::is_timed_lockable_v<mutex_type>,
+                      "try_read_until requires TimedLockable Mutex");
+        return read_access(*this, deadline);
+    }
+
+    /**
+     * @brief Lock for writing once the value satisfies the predicate, e.g. the
+     * consumer waiting for the queue to become non-empty, without polling and without
+     * the separate condition variable. Requires layout::waitable. The predicate is
+     * checked under the lock. Every write (the destruction of write_access, assignment,
+     * swap, update() etc.) also checks it, and wakes up the waiter only if it is true.
+     * The woken waiter checks it again after relocking, since other writers may get
+     * the lock first, so the predicate is called by writers' threads too.
+     * @param pred The predicate called with the const reference to the value.
+     * @return write_access wrapper owning the lock, with pred(value) being true.
+     */
+    template<class Pred>
+    write_access wait_write(Pred pred) {
+        static_assert(waitable, "wait_write requires layout::waitable and synchronized Mutex");
+        std::unique_lock<mutex_type> lock(mutex);
+        auto ready = [this, &pred]() -> bool { return std::invoke(pred, std::as_const(storage.get())); };
+        waiters.wait(lock, ready);
+        lock.release();
+        return write_access(*this, std::adopt_lock);
+    }
+
+    /**
+     * @brief Lock for reading once the value satisfies the predicate, see wait_write().
+     * Waiters of SharedLockable Mutex hold the shared lock while checking.
+     * @param pred The predicate called with the const reference to the value.
+     * @return read_access wrapper owning the lock, with pred(value) being true.
+     */
+    template<class Pred>
+    read_access wait_read(Pred pred) const {
+        static_assert(waitable, "wait_read requires layout::waitable and synchronized Mutex");
+        read_lock lock(mutex);
+        auto ready = [this, &pred]() -> bool { return std::invoke(pred, storage.get()); };
+        waiters.wait(lock, ready);
+        lock.release();
+        return read_access(*this, std::adopt_lock);
+    }
+
+    /**
+     * @brief Lock for writing once the value satisfies the predicate, waiting no
+     * longer than the timeout, see wait_write().
+     * @param timeout Maximum duration to wait for.
+     * @param pred The predicate called with the const reference to the value.
+     * @return write_access wrapper, owning the lock only if pred(value) became true in time.
+     */
+    template<class Rep, class Period, class Pred>
+    write_access wait_write_for(const std::chrono::duration<Rep, Period> &timeout, Pred pred) {
+        return wait_write_until(std::chrono::steady_clock::now() + timeout, std::move(pred));
+    }
+
+    /**
+     * @brief Lock for writing once the value satisfies the predicate, waiting no
+     * longer than until the deadline, see wait_write().
+     * @param deadline Time point to wait until.
+     * @param pred The predicate called with the const reference to the value.
+     * @return write_access wrapper, owning the lock only if pred(value) became true in time.
+     */
+    template<class Clock, class Duration, class Pred>
+    write_access wait_write_until(const std::chrono::time_point<Clock, Duration> &deadline, Pred pred) {
+        static_assert(waitable, "wait_write_until requires layout::waitable and synchronized Mutex");
+        std::unique_lock<mutex_type> lock(mutex);
+        auto ready = [this, &pred]() -> bool { return std::invoke(pred, std::as_const(storage.get())); };
+        if (!waiters.wait_until(lock, deadline, ready))
+            return write_access(*this, std::defer_lock);
+        lock.release();
+        return write_access(*this, std::adopt_lock);
+    }
+
+    /**
+     * @brief Lock for reading once the value satisfies the predicate, waiting no
+     * longer than the timeout, see wait_read().
+     * @param timeout Maximum duration to wait for.
+     * @param pred The predicate called with the const reference to the value.
+     * @return read_access wrapper, owning the lock only if pred(value) became true in time.
+     */
+    template<class Rep, class Period, class Pred>
+    read_access wait_read_for(const std::chrono::duration<Rep, Period> &timeout, Pred pred) const {
+        return wait_read_until(std::chrono::steady_clock::now() + timeout, std::move(pred));
+    }
+
+    /**
+     * @brief Lock for reading once the value satisfies the predicate, waiting no
+     * longer than until the deadline, see wait_read().
+     * @param deadline Time point to wait until.
+     * @param pred The predicate called with the const reference to the value.
+     * @return read_access wrapper, owning the lock only if pred(value) became true in time.
+     */
+    template<class Clock, class Duration, class Pred>
+    read_access wait_read_until(const std::chrono::time_point<Clock, Duration> &deadline, Pred pred) const {
+        static_assert(waitable, "wait_read_until requires layout::waitable and synchronized Mutex");
+        read_lock lock(mutex);
+        auto ready = [this, &pred]() -> bool { return std::invoke(pred, storage.get()); };
+        if (!waiters.wait_until(lock, deadline, ready))
+            return read_access(*this, std::defer_lock);
+        lock.release();
+        return read_access(*this, std::adopt_lock);
+    }
+
+    /**
+     * @brief Read the value through the replica cached by the calling thread, e.g. for
+     * feature flags which are read all the time and changed rarely. While the version
+     * is unchanged, the read is one relaxed load of the version and no lock, otherwise
+     * the replica is refreshed under the read lock. Writes become visible to the reader
+     * eventually, not immediately. Every thread keeps the replica of each smart_mutex
+     * it has read until the thread exits, so it is meant for long living values.
+     * @return The replica reference, valid until the next cached_read() of this
+     * smart_mutex by the calling thread.
+     */
+    const T &cached_read() const {
+        static_assert(versioned || unsynchronized,
+                      "cached_read requires layout::versioned and not transactional Mutex");
+        if constexpr (unsynchronized) {
+            return storage.get();
+        } else {
+            struct replica
+            {
+                std::uint64_t version = 0;
+                std::optional<T> copy;
+            };
+            thread_local std::unordered_map<const smart_mutex *, replica> replicas;
+            thread_local const smart_mutex *last_owner = nullptr;
+            thread_local replica *last = nullptr;
+
+            if (last_owner == this && last->version == version.load(std::memory_order_relaxed))
+                return *last->copy;
+
+            auto &cached = last_owner == this ? *last : replicas[this];
+            read_lock lock(mutex);
+            const auto current = version.load(std::memory_order_relaxed);
+            if (!cached.copy || cached.version != current) {
+                cached.copy = storage.get();
+                cached.version = current;
+            }
+            last_owner = this;
+            last = &cached;
+            return *cached.copy;
+        }
+    }
+
+    /**
+     * @brief Read the value without locking, e.g. the small record read all the time.
+     * The value is copied word by word and the copy is validated by the version
+     * afterwards, if a writer was active, the copy is repeated, and after the number
+     * of failed attempts it is made under the read lock. Readers don't write shared
+     * memory, so they don't slow down each other and writers. Requires trivially
+     * copyable T stored inline (not layout::indirect), layout::versioned and not
+     * transactional Mutex.
+     * @param fn The function accepting <code>const T &</code>, called once with the
+     * consistent copy of the value after it is validated, without any lock.
+     * @param attempts The number of optimistic copies before locking.
+     * @return The function result.
+     */
+    template<typename Fn>
+    std::invoke_result_t<Fn &, const T &> optimistic_read(Fn &&fn, std::size_t attempts = 4) const {
+        static_assert(std::is_trivially_copyable_v<T>, "optimistic_read requires trivially copyable type");
+        // The pointer may be exchanged and the previous value freed while it is copied.
+        static_assert(!indirect, "optimistic_read requires the value stored inline, not layout::indirect");
+        static_assert(versioned || unsynchronized,
+                      "optimistic_read requires layout::versioned and not transactional Mutex");
+        if constexpr (unsynchronized) {
+            return std::invoke(fn, storage.get());
+        } else {
+            alignas(T) unsigned char copy[sizeof(T)];
+            bool validated = false;
+            for (std::size_t i = 0; i < attempts && !validated; ++i) {
+                const auto before = version.load(std::memory_order_acquire);
+                if (before & 1) {
+                    detail::cpu_relax();
+                    continue;
+                }
+                detail::racy_copy(copy, storage.get());
+                validated = validate(before);
+            }
+            if (!validated) {
+                read_lock lock(mutex);
+                std::memcpy(copy, &storage.get(), sizeof(T));
+            }
+            return std::invoke(fn, *std::launder(reinterpret_cast<const T *>(copy)));
+        }
+    }
+
+    /**
+     * @brief Replace the value with the one computed from it outside the lock, e.g.
+     * rebuilding the sorted vector. The value is copied under the read lock, fn builds
+     * the new value from the copy without any lock, and it is committed under the short
+     * write lock if nobody has written meanwhile, otherwise the update is retried. After
+     * the number of failed attempts fn is run under the write lock. Without layout::versioned
+     * and with transactional Mutex it is always run under the write lock. The replaced
+     * value is destroyed after unlocking.
+     * @param fn The function accepting <code>const T &</code> and returning the new value,
+     * it could be called several times.
+     * @param attempts The number of attempts to compute the value outside the lock.
+     */
+    template<typename Fn>
+    void update(Fn &&fn, std::size_t attempts = 4) {
+        for (std::size_t i = 0; versioned && i < attempts; ++i) {
+            std::uint64_t before = 0;
+            // The copy is a temporary, freed as soon as the new value is built.
+            T desired = std::invoke(fn, snapshot(before));
+            if (commit(desired, before))
+                return;
+        }
+        std::optional<T> replaced;
+        std::lock_guard lock(mutex);
+        replaced.emplace(std::invoke(fn, std::as_const(storage.get())));
+        const write_scope scope{*this};
+        detail::replace_value(storage.get(), *replaced);
+    }
+
+    /**
+     * @brief Apply the function to the underlying value by the current lock holder
+     * (flat combining). Operations of many threads are executed in one batch while
+     * the value stays in the cache of one core. Requires the combining Mutex,
+     * e.g. im::combining_mutex.
+     * @param fn The function accepting <code>T &</code>, it must not access this smart_mutex.
+     * @return The function result, exceptions are rethrown in the calling thread.
+     */
+    template<typename Fn>
+    auto combine(Fn &&fn) {
+        static_assert(detail::is_combining_v<mutex_type>, "combine requires combining Mutex");
+        return mutex.combine([this, &fn]() {
+            const write_scope scope{*this};
+            return std::invoke(fn, storage.get());
+        });
+    }
+
+    /**
+     * @brief Acquire write access from the coroutine without blocking the thread:
+     * <code>auto wa = co_await smart.async_write();</code>. Requires the Mutex
+     * with awaitable <code>lock_async()</code>, e.g. im::async_mutex.
+     * @param executor Optional executor resuming the coroutine when the lock is handed over.
+     * @return Awaitable resulting in write_access.
+     */
+    template<typename ...Executor>
+    auto async_write(Executor &&...executor) {
+        static_assert(detail::is_async_lockable_v<mutex_type>, "async_write requires async lockable Mutex");
+        using awaiter = decltype(mutex.lock_async(std::forward<Executor>(executor)...));
+        return detail::access_awaiter<write_access, smart_mutex, awaiter>{
+            *this, mutex.lock_async(std::forward<Executor>(executor)...)};
+    }
+
+    /**
+     * @brief Acquire read access from the coroutine without blocking the thread:
+     * <code>auto ra = co_await smart.async_read();</code>. Requires the Mutex
+     * with awaitable <code>lock_async()</code>, e.g. im::async_mutex.
+     * @param executor Optional executor resuming the coroutine when the lock is handed over.
+     * @return Awaitable resulting in read_access.
+     */
+    template<typename ...Executor>
+    auto async_read(Executor &&...executor) const {
+        static_assert(detail::is_async_lockable_v<mutex_type>, "async_read requires async lockable Mutex");
+        using awaiter = decltype(mutex.lock_async(std::forward<Executor>(executor)...));
+        return detail::access_awaiter<read_access, smart_mutex, awaiter>{
+            *this, mutex.lock_async(std::forward<Executor>(executor)...)};
+    }
+
   public:
     // STL like helpers
     /**
@@ -206,19 +1700,23 @@ class smart_mutex
      * @param lhs The smart_mutex whose content will be swapped.
      * @param rhs The smart_mutex whose content will be swapped.
      */
-    friend void swap(smart_mutex &lhs, smart_mutex &rhs) noexcept {
+    friend void swap(smart_mutex &lhs, smart_mutex &rhs) noexcept(!detail::is_swap_bound_to_allocator_v<T> || indirect) {
         std::scoped_lock lock(lhs.mutex, rhs.mutex);
-        std::swap(lhs.value, rhs.value);
+        const write_scope lhs_scope{lhs}, rhs_scope{rhs};
+        lhs.storage.swap(rhs.storage);
     }
 
     /**
-     * @brief Swap the contents of smart_mutex and the value of underlying type.
+     * @brief Swap the contents of smart_mutex and the value of underlying type. Values
+     * with allocators not propagated on swap (e.g. <code>std::pmr</code> containers)
+     * are swapped by moves, which copy the elements if the allocators differ.
      * @param lhs The smart_mutex whose content will be swapped.
      * @param rhs The value of underlying type.
      */
-    friend void swap(smart_mutex &lhs, T &rhs) noexcept {
+    friend void swap(smart_mutex &lhs, T &rhs) noexcept(!detail::is_swap_bound_to_allocator_v<T>) {
         std::lock_guard lock(lhs.mutex);
-        std::swap(lhs.value, rhs);
+        const write_scope scope{lhs};
+        detail::swap_values(lhs.storage.get(), rhs);
     }
 
     /**
@@ -226,19 +1724,189 @@ class smart_mutex
      * @param lhs The value of underlying type.
      * @param rhs The smart_mutex whose content will be swapped.
      */
-    friend void swap(T &lhs, smart_mutex &rhs) noexcept {
+    friend void swap(T &lhs, smart_mutex &rhs) noexcept(!detail::is_swap_bound_to_allocator_v<T>) {
         std::lock_guard lock(rhs.mutex);
-        std::swap(lhs, rhs.value);
+        const write_scope scope{rhs};
+        detail::swap_values(lhs, rhs.storage.get());
+    }
+
+  private:
+    // Construct the value from other, which lock is held by the caller for the whole construction.
+    template<class Lock>
+    smart_mutex(const smart_mutex &other, Lock &&) : storage(other.storage.get()) {
+    }
+
+    template<class Lock>
+    smart_mutex(smart_mutex &&other, Lock &&) : storage(std::move(other.storage)) {
+    }
+
+    // Make the version odd before the write, so optimistic readers know the value is changing.
+    // The lock has to be held by the caller.
+    void begin_write() const noexcept {
+        version.begin_write();
+    }
+
+    // Make the version even again, update the atomic mirror and wake up waiters after the write.
+    // The lock has to be held by the caller.
+    void publish() const noexcept {
+        if constexpr (lock_free_reads)
+            mirror.store(storage.get());
+        version.end_write();
+        waiters.notify();
+    }
+
+    // Copy the value under the read lock together with its version.
+    const T snapshot(std::uint64_t &before) const {
+        read_lock lock(mutex);
+        before = version.load(std::memory_order_relaxed);
+        return storage.get();
+    }
+
+    // Commit the value computed outside the lock, if the version is still the same.
+    // The replaced value is left in desired to be destroyed after unlocking.
+    bool commit(T &desired, std::uint64_t before) {
+        if constexpr (indirect && !detail::is_swap_bound_to_allocator_v<T>) {
+            auto replacement = std::make_unique<T>(std::move(desired));
+            std::lock_guard lock(mutex);
+            if (version.load(std::memory_order_relaxed) != before)
+                return false;
+            const write_scope scope{*this};
+            storage.ptr.swap(replacement);
+        } else {
+            std::lock_guard lock(mutex);
+            if (version.load(std::memory_order_relaxed) != before)
+                return false;
+            const write_scope scope{*this};
+            detail::replace_value(storage.get(), desired);
+        }
+        return true;
+    }
+
+    // Check if no write has started since the version was read before the optimistic run.
+    bool validate(std::uint64_t before) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version.load(std::memory_order_relaxed) == before;
     }
 
+    // Marks the value as being written for the scope, even if the write throws.
+    struct write_scope
+    {
+        explicit write_scope(const smart_mutex &self) noexcept : self(self) { self.begin_write(); }
+
+        ~write_scope() { self.publish(); }
+
+        write_scope(const write_scope &) = delete;
+        write_scope &operator=(const write_scope &) = delete;
+
+        const smart_mutex &self;
+    };
+
+    // The lock of the moved from smart_mutex, which value is marked as being written.
+    struct move_lock
+    {
+        std::unique_lock<mutex_type> lock;
+        write_scope scope;
+    };
+
   private:
     // Member variables
-    // The internal Mutex object for providing threadsafety access.
-    mutable Mutex mutex;
-    // The internal value protected by mutex.
-    T value;
+    // The internal Mutex object for providing threadsafety access, its alignment
+    // defines the alignment of the whole object. Takes no space if empty.
+    SMART_MUTEX_NO_UNIQUE_ADDRESS alignas(Layout::object_alignment) alignas(mutex_type) mutable mutex_type mutex;
+    // The internal value protected by mutex, inline or behind the pointer depending on Layout.
+    alignas(Layout::member_alignment) detail::value_storage<T, indirect> storage;
+    // The version of the value, bumped by every write, empty unless the layout is versioned.
+    SMART_MUTEX_NO_UNIQUE_ADDRESS mutable detail::version_counter<versioned> version;
+    // The atomic copy of the value for lock-free reads, empty if T isn't lock-free atomic.
+    SMART_MUTEX_NO_UNIQUE_ADDRESS mutable detail::atomic_mirror<T, lock_free_reads> mirror{storage.get()};
+    // The threads blocked in wait_write() and wait_read(), empty if not waitable.
+    SMART_MUTEX_NO_UNIQUE_ADDRESS mutable detail::wait_list<condition_type, waitable> waiters;
+};
+
+/**
+ * @brief smart_mutex aligned to the cache line to avoid false sharing between instances.
+ */
+template<class T, class Mutex = std::mutex>
+using padded_smart_mutex = smart_mutex<T, Mutex, layout::cache_padded>;
+
+/**
+ * @brief smart_mutex with the mutex and the value on separate cache lines.
+ */
+template<class T, class Mutex = std::mutex>
+using isolated_smart_mutex = smart_mutex<T, Mutex, layout::cache_isolated>;
+
+/**
+ * @brief smart_mutex keeping the value behind the owned pointer for O(1) swap and exchange.
+ */
+template<class T, class Mutex = std::mutex>
+using indirect_smart_mutex = smart_mutex<T, Mutex, layout::indirect>;
+
+/**
+ * @brief smart_mutex keeping the version of the value for cached_read() and optimistic_read().
+ */
+template<class T, class Mutex = std::mutex>
+using versioned_smart_mutex = smart_mutex<T, Mutex, layout::versioned<>>;
+
+/**
+ * @brief smart_mutex which threads can wait on with wait_write() and wait_read().
+ */
+template<class T, class Mutex = std::mutex>
+using waitable_smart_mutex = smart_mutex<T, Mutex, layout::waitable<>>;
+
+namespace detail
+{
+
+/**
+ * @brief The access proxy type for the smart_mutex reference, read_access for
+ * const qualified and write_access otherwise.
+ */
+template<class Smart>
+struct access_for
+{
+    typedef typename Smart::write_access type;
+};
+
+template<class Smart>
+struct access_for<const Smart>
+{
+    typedef typename Smart::read_access type;
 };
 
+template<class Smart>
+using access_for_t = typename access_for<Smart>::type;
+
+template<class Tuple, std::size_t ...I>
+void lock_in_address_order(Tuple &proxies, const std::array<const void *, sizeof...(I)> &addresses,
+                           std::index_sequence<I...>) {
+    using locker = void (*)(Tuple &);
+    const std::array<locker, sizeof...(I)> lockers = {[](Tuple &t) { std::get<I>(t).lock(); }...};
+
+    std::array<std::size_t, sizeof...(I)> order = {I...};
+    std::sort(order.begin(), order.end(), [&addresses](std::size_t lhs, std::size_t rhs) {
+        return std::less<const void *>()(addresses[lhs], addresses[rhs]);
+    });
+    for (auto i : order)
+        lockers[i](proxies);
+}
+
+} // end namespace detail
+
+/**
+ * @brief Lock several smart_mutexes at once without deadlock. Locks are always
+ * taken in address order, so concurrent calls with overlapping sets never wait
+ * for each other in a cycle and never retry.
+ * @tparam Smart Types of smart_mutexes, const qualified ones are locked for reading.
+ * @param smart Distinct smart_mutexes to lock.
+ * @return Tuple of write_access/read_access proxies in the order of arguments.
+ */
+template<class ...Smart>
+std::tuple<detail::access_for_t<Smart>...> access_all(Smart &...smart) {
+    std::tuple<detail::access_for_t<Smart>...> proxies(detail::access_for_t<Smart>(smart, std::defer_lock)...);
+    detail::lock_in_address_order(proxies, {static_cast<const void *>(&smart)...},
+                                  std::index_sequence_for<Smart...>());
+    return proxies;
+}
+
 } // end namespace im
 
 #endif //SMARTMUTEX__SMART_MUTEX_H_
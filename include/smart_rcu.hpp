@@ -0,0 +1,220 @@
+// Implementation of the smart read-copy-update wrapper.
+//
+
+#ifndef SMARTMUTEX__SMART_RCU_H_
+#define SMARTMUTEX__SMART_RCU_H_
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace im
+{
+
+/**
+ * @class smart_rcu
+ * @brief Smart RCU - read-copy-update object wrapper for large read mostly data.
+ * Readers get immutable snapshot of the value without taking a lock, writers
+ * change the private copy and publish it atomically. Old snapshots stay valid
+ * until their last reader drops them.
+ * @tparam T The type of the element stored in the smart_rcu. It has to be
+ * copy constructible.
+ * @tparam Mutex The Mutex type used for serializing writers. It has to meet the
+ * BasicLockable requirements imposed by STL.
+ */
+template<class T, class Mutex = std::mutex>
+class smart_rcu
+{
+  public:
+    // Container specific types
+    //! A type representing the immutable snapshot of underlying value.
+    typedef std::shared_ptr<const T> snapshot;
+
+    /**
+     * @class write_access
+     * @brief Proxy object for providing write access in critical section.
+     * Changes are made on the private copy of the value, which is published on
+     * proxy destruction. The copy is dropped if the scope is left by exception.
+     */
+    struct write_access
+    {
+        explicit write_access(smart_rcu &smart)
+            : ref(smart), lg(ref.mutex), copy(std::make_shared<T>(*ref.load())),
+              exceptions(std::uncaught_exceptions()) {
+        }
+
+        ~write_access() {
+            if (std::uncaught_exceptions() == exceptions)
+                ref.publish(std::move(copy));
+        }
+
+        /**
+         * @brief Get the underlying type pointer.
+         * @return The underlying type pointer.
+         */
+        T *operator->() const noexcept { return copy.get(); }
+
+      private:
+        // The internal reference to overlying smart_rcu object.
+        smart_rcu &ref;
+        // The internal mutex wrapper with RAII mechanism for owning a mutex.
+        std::lock_guard<Mutex> lg;
+        // The private copy of underlying value, published on destruction.
+        std::shared_ptr<T> copy;
+        // The number of uncaught exceptions on proxy creation.
+        int exceptions;
+    };
+
+    /**
+     * @class read_access
+     * @brief Proxy object for providing read access to immutable snapshot
+     * of underlying value. No locks are held.
+     */
+    struct read_access
+    {
+        explicit read_access(const smart_rcu &smart) : snap(smart.load()) {
+        }
+
+        /**
+         * @brief Get the underlying type pointer.
+         * @return The underlying type pointer.
+         */
+        const T *operator->() const noexcept { return snap.get(); }
+
+      private:
+        // The snapshot of underlying value kept alive by this proxy.
+        snapshot snap;
+    };
+
+  public:
+    // Construction/Destruction
+    /**
+     * @brief Crate smart_rcu with copying value of underlying type into it.
+     * @param other Element of underlying type
+     */
+    explicit smart_rcu(const T &other = T()) : current(std::make_shared<const T>(other)) {
+    }
+
+    /**
+     * @brief Create smart_rcu with moving value of underlying type into it.
+     * @param other Element of underlying type
+     */
+    explicit smart_rcu(T &&other) : current(std::make_shared<const T>(std::move(other))) {
+    }
+
+    /**
+     * The copy constructor.
+     * @brief Creates smart_rcu sharing the current snapshot of other.
+     * @param other The smart_rcu to be copied.
+     */
+    smart_rcu(const smart_rcu &other) : current(other.load()) {
+    }
+
+    /**
+     * The destructor.
+     * @brief Destroys the smart_rcu.
+     */
+    ~smart_rcu() = default;
+
+    // Assign methods
+    /**
+     * The assign operator.
+     * @brief Publishes the current snapshot of other in this smart_rcu.
+     * @param other The smart_rcu to be copied.
+     * @return This smart_rcu.
+     */
+    smart_rcu &operator=(const smart_rcu &other) {
+        auto snap = other.load();
+        std::lock_guard lock(mutex);
+        publish(std::move(snap));
+        return *this;
+    }
+
+    /**
+     * @brief Compare other value of underlying type with this smart_rcu
+     * to determine if they are equal.
+     * @param lhs smart_rcu to compare with.
+     * @param rhs value of underlying type to compare with.
+     * @return Equal comparison result.
+     */
+    friend bool operator==(const smart_rcu &lhs, const T &rhs) {
+        return *lhs.load() == rhs;
+    }
+
+    /**
+     * @brief Compare other value of underlying type with this smart_rcu.
+     * @param lhs smart_rcu to compare with.
+     * @param rhs value of underlying type to compare with.
+     * @return Unequal comparison result.
+     */
+    friend bool operator!=(const smart_rcu &lhs, const T &rhs) {
+        return *lhs.load() != rhs;
+    }
+
+    // Element access
+    /**
+     * @brief Get the current snapshot of the underlying value without locking.
+     * @return Immutable snapshot of underlying value
+     */
+    snapshot load() const noexcept {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        return current.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&current, std::memory_order_acquire);
+#endif
+    }
+
+    /**
+     * @brief Replace the underlying value with the new one.
+     * @param other New value of underlying type.
+     */
+    void store(T other) {
+        auto snap = std::make_shared<const T>(std::move(other));
+        std::lock_guard lock(mutex);
+        publish(std::move(snap));
+    }
+
+    /**
+     * @brief Get copy of the underlying value in smart_rcu
+     * @return Underlying value
+     */
+    operator T() const {
+        return *load();
+    }
+
+    /**
+     * @brief Lock free access to read only inner functions. There is no
+     * implicit write access, use write_access explicitly to avoid accidental copies.
+     * @return read_access snapshot wrapper for underlying value
+     */
+    read_access operator->() const {
+        return read_access(*this);
+    }
+
+  private:
+    // Publish the new snapshot, mutex has to be owned by the caller.
+    void publish(snapshot snap) noexcept {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        current.store(std::move(snap), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&current, std::move(snap), std::memory_order_release);
+#endif
+    }
+
+  private:
+    // Member variables
+    // The internal Mutex object for serializing writers.
+    mutable Mutex mutex;
+    // The currently published snapshot.
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<snapshot> current;
+#else
+    snapshot current;
+#endif
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__SMART_RCU_H_
@@ -0,0 +1,241 @@
+// Implementation of the smart seqlock wrapper.
+//
+
+#ifndef SMARTMUTEX__SMART_SEQLOCK_H_
+#define SMARTMUTEX__SMART_SEQLOCK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @class smart_seqlock
+ * @brief Smart seqlock - sequence lock object wrapper for small trivially
+ * copyable data. Readers never write shared memory, they copy data out and
+ * retry if the sequence counter was changed by the concurrent writer.
+ * @tparam T The type of the element stored in the smart_seqlock. It has to be
+ * trivially copyable and default constructible.
+ * @tparam Mutex The Mutex type used for serializing writers. It has to meet the
+ * BasicLockable requirements imposed by STL.
+ */
+template<class T, class Mutex = std::mutex>
+class smart_seqlock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "smart_seqlock requires trivially copyable type");
+    static_assert(std::is_default_constructible_v<T>, "smart_seqlock requires default constructible type");
+
+    // The type of word used for racy-free copying of the underlying value.
+    using word_type = std::size_t;
+    // The number of words needed for storing the underlying value.
+    static constexpr std::size_t words = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+  public:
+    // Container specific types
+    /**
+     * @class write_access
+     * @brief Proxy object for providing write access in critical section.
+     * Changes are made on the local copy and published on proxy destruction,
+     * so readers retry only while the copy is stored back.
+     */
+    struct write_access
+    {
+        explicit write_access(smart_seqlock &smart) : ref(smart), lg(ref.mutex), copy(ref.load_locked()) {
+        }
+
+        ~write_access() {
+            ref.store_locked(copy);
+        }
+
+        /**
+         * @brief Get the underlying type pointer.
+         * @return The underlying type pointer.
+         */
+        T *operator->() noexcept { return &copy; }
+
+      private:
+        // The internal reference to overlying smart_seqlock object.
+        smart_seqlock &ref;
+        // The internal mutex wrapper with RAII mechanism for owning a mutex.
+        std::lock_guard<Mutex> lg;
+        // The local copy of underlying value, published on destruction.
+        T copy;
+    };
+
+    /**
+     * @class read_access
+     * @brief Proxy object for providing read access to consistent snapshot
+     * of underlying value. No locks are held.
+     */
+    struct read_access
+    {
+        explicit read_access(const smart_seqlock &smart) : copy(smart.load()) {
+        }
+
+        /**
+         * @brief Get the underlying type pointer.
+         * @return The underlying type pointer.
+         */
+        const T *operator->() const noexcept { return &copy; }
+
+      private:
+        // The consistent snapshot of underlying value.
+        T copy;
+    };
+
+  public:
+    // Construction/Destruction
+    /**
+     * @brief Create smart_seqlock with copying value of underlying type into it.
+     * @param other Element of underlying type
+     */
+    explicit smart_seqlock(const T &other = T()) {
+        store_locked(other);
+    }
+
+    /**
+     * The copy constructor.
+     * @brief Creates a copy of the specified smart_seqlock.
+     * @param other The smart_seqlock to be copied.
+     */
+    smart_seqlock(const smart_seqlock &other) : smart_seqlock(other.load()) {
+    }
+
+    /**
+     * The destructor.
+     * @brief Destroys the smart_seqlock.
+     */
+    ~smart_seqlock() = default;
+
+    // Assign methods
+    /**
+     * The assign operator.
+     * @brief Makes this smart_seqlock to become a copy of the specified smart_seqlock.
+     * @param other The smart_seqlock to be copied.
+     * @return This smart_seqlock.
+     */
+    smart_seqlock &operator=(const smart_seqlock &other) {
+        store(other.load());
+        return *this;
+    }
+
+    /**
+     * @brief Compare other value of underlying type with this smart_seqlock
+     * to determine if they are equal.
+     * @param lhs smart_seqlock to compare with.
+     * @param rhs value of underlying type to compare with.
+     * @return Equal comparison result.
+     */
+    friend bool operator==(const smart_seqlock &lhs, const T &rhs) {
+        return lhs.load() == rhs;
+    }
+
+    /**
+     * @brief Compare other value of underlying type with this smart_seqlock.
+     * @param lhs smart_seqlock to compare with.
+     * @param rhs value of underlying type to compare with.
+     * @return Unequal comparison result.
+     */
+    friend bool operator!=(const smart_seqlock &lhs, const T &rhs) {
+        return lhs.load() != rhs;
+    }
+
+    // Element access
+    /**
+     * @brief Get consistent copy of the underlying value without locking.
+     * @return Underlying value
+     */
+    T load() const noexcept {
+        word_type buffer[words];
+        for (;;) {
+            const auto before = seq.load(std::memory_order_acquire);
+            if (before & 1u) {
+                detail::cpu_relax();
+                continue;
+            }
+            for (std::size_t i = 0; i < words; ++i)
+                buffer[i] = data[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == before)
+                break;
+        }
+        T result;
+        std::memcpy(&result, buffer, sizeof(T));
+        return result;
+    }
+
+    /**
+     * @brief Replace the underlying value.
+     * @param other New value of underlying type.
+     */
+    void store(const T &other) {
+        std::lock_guard lock(mutex);
+        store_locked(other);
+    }
+
+    /**
+     * @brief Get consistent copy of the underlying value without locking.
+     * @return Underlying value
+     */
+    operator T() const noexcept {
+        return load();
+    }
+
+    /**
+     * @brief Thread safe access to inner functions
+     * @return write_access lockable wrapper for underlying value
+     */
+    write_access operator->() {
+        return write_access(*this);
+    }
+
+    /**
+     * @brief Access to read only inner functions of consistent snapshot
+     * @return read_access snapshot wrapper for underlying value
+     */
+    read_access operator->() const {
+        return read_access(*this);
+    }
+
+  private:
+    // Load the underlying value, mutex has to be owned by the caller.
+    T load_locked() const noexcept {
+        word_type buffer[words];
+        for (std::size_t i = 0; i < words; ++i)
+            buffer[i] = data[i].load(std::memory_order_relaxed);
+        T result;
+        std::memcpy(&result, buffer, sizeof(T));
+        return result;
+    }
+
+    // Store the underlying value, mutex has to be owned by the caller.
+    void store_locked(const T &other) noexcept {
+        word_type buffer[words] = {};
+        std::memcpy(buffer, &other, sizeof(T));
+        const auto current = seq.load(std::memory_order_relaxed);
+        seq.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < words; ++i)
+            data[i].store(buffer[i], std::memory_order_relaxed);
+        seq.store(current + 2, std::memory_order_release);
+    }
+
+  private:
+    // Member variables
+    // The internal Mutex object for serializing writers.
+    mutable Mutex mutex;
+    // The sequence counter, odd while the writer stores the value.
+    std::atomic<std::size_t> seq = 0;
+    // The internal value split into words.
+    std::atomic<word_type> data[words];
+};
+
+} // end namespace im
+
+#endif //SMARTMUTEX__SMART_SEQLOCK_H_
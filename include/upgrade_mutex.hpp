@@ -0,0 +1,204 @@
+// Implementation of the upgradeable shared mutex policy.
+//
+
+#ifndef SMARTMUTEX__UPGRADE_MUTEX_H_
+#define SMARTMUTEX__UPGRADE_MUTEX_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "detail/atomic_wait.hpp"
+#include "detail/hardware.hpp"
+
+namespace im
+{
+
+/**
+ * @class basic_upgrade_mutex
+ * @brief Shared mutex with the third, upgrade ownership mode. The upgrade lock
+ * coexists with shared owners but not with other upgrade or exclusive owners,
+ * and could be atomically promoted to the exclusive lock, i.e. nobody could
+ * modify the data between the check and the modification. While promotion waits
+ * for readers to leave, new readers are blocked. Exclusive lock() goes through
+ * the upgrade mode too, so writers and upgraders are served one by one.
+ * Meets the Lockable and SharedLockable requirements.
+ * @tparam Spins The number of spin iterations before parking the thread.
+ */
+template<std::uint32_t Spins = 128>
+class basic_upgrade_mutex
+{
+    // State bits, the lower bits are the number of shared owners.
+    static constexpr std::uint32_t exclusive = 1u << 31;
+    static constexpr std::uint32_t upgrade = 1u << 30;
+    static constexpr std::uint32_t promoting = 1u << 29;
+    static constexpr std::uint32_t parked = 1u << 28;
+    static constexpr std::uint32_t readers = parked - 1;
+
+  public:
+    basic_upgrade_mutex() noexcept = default;
+
+    basic_upgrade_mutex(const basic_upgrade_mutex &) = delete;
+    basic_upgrade_mutex &operator=(const basic_upgrade_mutex &) = delete;
+
+    // Exclusive ownership
+    /**
+     * @brief Lock the mutex exclusively, waiting for all other owners to leave.
+     */
+    void lock() noexcept {
+        if (try_lock())
+            return;
+        lock_upgrade();
+        unlock_upgrade_and_lock();
+    }
+
+    /**
+     * @brief Try to lock the mutex exclusively without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock() noexcept {
+        auto s = state.load(std::memory_order_relaxed);
+        return (s & ~parked) == 0 &&
+               state.compare_exchange_strong(s, s | exclusive, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Unlock the exclusively locked mutex.
+     */
+    void unlock() noexcept {
+        release(exclusive);
+    }
+
+    // Shared ownership
+    /**
+     * @brief Lock the mutex in shared mode, waiting for the exclusive owner to leave.
+     */
+    void lock_shared() noexcept {
+        auto s = state.load(std::memory_order_relaxed);
+        do {
+            wait_while(s, [](std::uint32_t current) { return (current & (exclusive | promoting)) != 0; });
+        } while (!state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Try to lock the mutex in shared mode without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock_shared() noexcept {
+        auto s = state.load(std::memory_order_relaxed);
+        while ((s & (exclusive | promoting)) == 0) {
+            if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Unlock the mutex locked in shared mode, the last reader wakes up the promoting owner.
+     */
+    void unlock_shared() noexcept {
+        const auto s = state.fetch_sub(1, std::memory_order_release);
+        if ((s & readers) == 1 && (s & parked) != 0)
+            release(0);
+    }
+
+    // Upgrade ownership
+    /**
+     * @brief Lock the mutex in upgrade mode, shared owners are still allowed.
+     */
+    void lock_upgrade() noexcept {
+        auto s = state.load(std::memory_order_relaxed);
+        do {
+            wait_while(s, [](std::uint32_t current) { return (current & (exclusive | upgrade)) != 0; });
+        } while (!state.compare_exchange_weak(s, s | upgrade, std::memory_order_acquire, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Try to lock the mutex in upgrade mode without blocking.
+     * @return true if the lock was acquired.
+     */
+    bool try_lock_upgrade() noexcept {
+        auto s = state.load(std::memory_order_relaxed);
+        while ((s & (exclusive | upgrade)) == 0) {
+            if (state.compare_exchange_weak(s, s | upgrade, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Unlock the mutex locked in upgrade mode.
+     */
+    void unlock_upgrade() noexcept {
+        release(upgrade);
+    }
+
+    /**
+     * @brief Atomically promote the upgrade lock to the exclusive one, blocks new
+     * readers and waits for the current ones to leave.
+     */
+    void unlock_upgrade_and_lock() noexcept {
+        auto s = state.fetch_or(promoting, std::memory_order_relaxed) | promoting;
+        do {
+            wait_while(s, [](std::uint32_t current) { return (current & readers) != 0; });
+        } while (!state.compare_exchange_weak(s, (s & parked) | exclusive, std::memory_order_acquire,
+                                              std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Try to promote the upgrade lock to the exclusive one without blocking.
+     * @return true if the lock was promoted, otherwise the upgrade lock is still held.
+     */
+    bool try_unlock_upgrade_and_lock() noexcept {
+        auto s = state.load(std::memory_order_relaxed);
+        while ((s & readers) == 0) {
+            if (state.compare_exchange_weak(s, (s & parked) | exclusive, std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Atomically demote the exclusive lock to the upgrade one, letting readers in.
+     */
+    void unlock_and_lock_upgrade() noexcept {
+        if (state.exchange(upgrade, std::memory_order_release) & parked)
+            detail::atomic_notify_all(state);
+    }
+
+  private:
+    // Spin and then park while the state is blocked for the caller, s is updated with the last seen state.
+    template<class Blocked>
+    void wait_while(std::uint32_t &s, Blocked blocked) noexcept {
+        for (std::uint32_t i = 0; i < Spins && blocked(s); ++i) {
+            detail::cpu_relax();
+            s = state.load(std::memory_order_relaxed);
+        }
+        while (blocked(s)) {
+            // Mark the state as having parked waiters, so the releasing owner wakes us up.
+            if ((s & parked) == 0 &&
+                !state.compare_exchange_weak(s, s | parked, std::memory_order_relaxed, std::memory_order_relaxed))
+                continue;
+            detail::atomic_wait(state, s | parked);
+            s = state.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Clear the ownership bits, wake up all parked waiters to recheck the state.
+    void release(std::uint32_t bits) noexcept {
+        if (state.fetch_and(~(bits | parked), std::memory_order_release) & parked)
+            detail::atomic_notify_all(state);
+    }
+
+  private:
+    // Member variables
+    // The ownership bits and the shared owners count.
+    std::atomic<std::uint32_t> state = 0;
+};
+
+//! Upgrade mutex with the default spin count.
+typedef basic_upgrade_mutex<> upgrade_mutex;
+
+} // end namespace im
+
+#endif //SMARTMUTEX__UPGRADE_MUTEX_H_
@@ -0,0 +1,75 @@
+//
+// Blocking and coroutine waiters of im::async_mutex queued together.
+//
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "async_mutex.hpp"
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+// Coroutine started eagerly and destroyed at the end, completion is reported by the flag.
+struct detached
+{
+    struct promise_type
+    {
+        detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+using counter = im::smart_mutex<std::uint64_t, im::async_mutex>;
+
+detached increment(counter &shared, std::atomic<bool> &done) {
+    {
+        auto wa = co_await shared.async_write();
+        ++*wa.operator->();
+    }
+    done.store(true, std::memory_order_release);
+}
+
+} // end namespace
+
+int main() {
+    constexpr int threads = 8;
+    constexpr std::uint64_t iterations = 20000;
+
+    // Every blocked thread returns from lock() as soon as the lock is handed to it and
+    // reuses its stack, while the releasing thread may still be waking it up.
+    counter shared;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&shared, t] {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                if ((i + t) % 2 == 0) {
+                    ++*shared.operator->().operator->();
+                } else {
+                    // Coroutines are resumed on the releasing thread, wait for each one so
+                    // the chain of inline resumptions stays short.
+                    std::atomic<bool> done{false};
+                    increment(shared, done);
+                    while (!done.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    CHECK(*shared.operator->().operator->() == threads * iterations);
+    CHECK(shared.try_write());
+    return 0;
+}
@@ -0,0 +1,62 @@
+//
+// Replicas of im::smart_mutex::cached_read() kept by reader threads and refreshed after writes.
+//
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+// Wait until the replica of the calling thread shows the expected value.
+bool refreshed(const im::versioned_smart_mutex<std::string> &flag, const std::string &expected) {
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (flag.cached_read() != expected) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+} // end namespace
+
+int main() {
+    im::versioned_smart_mutex<std::string> flag("off");
+    im::versioned_smart_mutex<std::string> other("other");
+    std::atomic<int> step{0};
+
+    std::thread reader([&] {
+        // The replica is reused while the value is unchanged.
+        const auto *replica = &flag.cached_read();
+        CHECK(*replica == "off");
+        CHECK(&flag.cached_read() == replica);
+        // Each smart_mutex has its own replica.
+        CHECK(other.cached_read() == "other");
+        CHECK(flag.cached_read() == "off");
+        step.store(1);
+
+        CHECK(refreshed(flag, "on"));
+        CHECK(other.cached_read() == "other");
+        step.store(2);
+    });
+
+    while (step.load() != 1)
+        std::this_thread::yield();
+    *flag.operator->().operator->() = "on";
+    reader.join();
+    CHECK(step.load() == 2);
+
+    // The writer's own replica is refreshed as well.
+    CHECK(flag.cached_read() == "on");
+    flag.exchange(std::string("off"));
+    CHECK(refreshed(flag, "off"));
+    return 0;
+}
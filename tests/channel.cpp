@@ -0,0 +1,242 @@
+//
+// Values passed through im::channel by producers and consumers, one by one, in batches
+// and through write_access/read_access proxies.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "channel.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+// Value counting the live instances, to check every one is destroyed once.
+struct tracked
+{
+    tracked() noexcept { ++live; }
+    explicit tracked(int value) noexcept : value(value) { ++live; }
+    tracked(const tracked &other) noexcept : value(other.value) { ++live; }
+    tracked(tracked &&other) noexcept : value(other.value) { ++live; }
+    tracked &operator=(const tracked &) = default;
+    tracked &operator=(tracked &&) = default;
+    ~tracked() { --live; }
+
+    int value = 0;
+    static inline int live = 0;
+};
+
+// Output iterator throwing on the assignment of the given value.
+struct throwing_output
+{
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    throwing_output &operator*() { return *this; }
+    throwing_output &operator++() { return *this; }
+    throwing_output &operator=(tracked &&value) {
+        if (value.value == poisoned)
+            throw std::runtime_error("output failed");
+        received->push_back(value.value);
+        return *this;
+    }
+
+    std::vector<int> *received;
+    int poisoned;
+};
+
+// Producer id in the high half, the sequence number of its value in the low one.
+constexpr std::uint64_t encode(std::uint64_t producer, std::uint64_t sequence) { return producer << 32 | sequence; }
+
+// Every value is received once, values of one producer are received by each consumer in order.
+void many_to_many() {
+    constexpr std::uint64_t producers = 4, consumers = 4, values = 20000;
+    im::channel<std::uint64_t, 64> queue;
+
+    std::vector<std::thread> threads;
+    for (std::uint64_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p] {
+            std::uint64_t sequence = 0;
+            while (sequence < values) {
+                switch (sequence % 3) {
+                case 0:
+                    queue.push(encode(p, sequence++));
+                    break;
+                case 1: {
+                    auto wa = queue.write();
+                    *wa = encode(p, sequence++);
+                    break;
+                }
+                default: {
+                    std::uint64_t batch[5];
+                    const auto count = std::min<std::uint64_t>(5, values - sequence);
+                    for (std::uint64_t i = 0; i < count; ++i)
+                        batch[i] = encode(p, sequence + i);
+                    sequence += queue.try_push(batch, batch + count);
+                }
+                }
+            }
+        });
+    }
+
+    std::vector<std::vector<std::uint64_t>> received(consumers);
+    std::atomic<std::uint64_t> remaining{producers * values};
+    for (std::uint64_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&queue, &remaining, &out = received[c], c] {
+            while (remaining.load(std::memory_order_relaxed) > 0) {
+                std::size_t count = 0;
+                if (c % 2 == 0) {
+                    count = queue.try_pop(std::back_inserter(out), 7);
+                } else if (auto ra = queue.try_read()) {
+                    out.push_back(*ra);
+                    count = 1;
+                }
+                if (count)
+                    remaining.fetch_sub(count, std::memory_order_relaxed);
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    std::vector<std::vector<bool>> seen(producers, std::vector<bool>(values, false));
+    for (const auto &out : received) {
+        std::vector<std::int64_t> last(producers, -1);
+        for (const auto value : out) {
+            const auto p = value >> 32, sequence = value & 0xffffffffu;
+            CHECK(p < producers && sequence < values);
+            CHECK(!seen[p][sequence]);
+            seen[p][sequence] = true;
+            CHECK(static_cast<std::int64_t>(sequence) > last[p]);
+            last[p] = static_cast<std::int64_t>(sequence);
+        }
+    }
+    for (const auto &producer : seen) {
+        for (const bool value : producer)
+            CHECK(value);
+    }
+    CHECK(queue.empty());
+}
+
+void boundaries() {
+    im::channel<int, 8> queue;
+    CHECK(!queue.try_pop());
+    CHECK(!queue.try_read());
+    for (int i = 0; i < 8; ++i)
+        CHECK(queue.try_push(i));
+    CHECK(!queue.try_push(8));
+    CHECK(!queue.try_write());
+    CHECK(queue.size() == 8);
+    for (int i = 0; i < 8; ++i) {
+        const auto value = queue.try_pop();
+        CHECK(value && *value == i);
+    }
+    CHECK(!queue.try_pop());
+    CHECK(queue.empty());
+}
+
+// Batches crossing the end of the ring buffer.
+void batches() {
+    im::channel<int, 8> queue;
+    for (int round = 0; round < 5; ++round) {
+        // Move the indices, so the batches start in the middle of the ring buffer.
+        for (int i = 0; i < round + 3; ++i)
+            CHECK(queue.try_push(-1));
+        std::vector<int> skipped;
+        CHECK(queue.try_pop(std::back_inserter(skipped), 8) == static_cast<std::size_t>(round + 3));
+
+        const int values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        CHECK(queue.try_push(values, values + 6) == 6);
+        CHECK(queue.try_push(values + 6, values + 10) == 2);
+        CHECK(queue.try_push(values + 8, values + 10) == 0);
+
+        std::vector<int> out;
+        CHECK(queue.try_pop(std::back_inserter(out), 3) == 3);
+        CHECK(queue.try_pop(std::back_inserter(out), 16) == 5);
+        CHECK(queue.try_pop(std::back_inserter(out), 16) == 0);
+        CHECK((out == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+    }
+}
+
+// Values are published and cells are freed by the proxies owning them, not the moved-from ones.
+void proxies() {
+    {
+        im::channel<tracked, 4> queue;
+        {
+            auto wa = queue.try_write();
+            CHECK(wa);
+            wa->value = 7;
+            CHECK(!queue.try_read());
+            {
+                auto moved = std::move(wa);
+                CHECK(!wa);
+            }
+            const auto ra = queue.try_read();
+            CHECK(ra && ra->value == 7);
+        }
+        CHECK(tracked::live == 0);
+
+        for (int i = 0; i < 4; ++i)
+            CHECK(queue.try_emplace(i));
+        {
+            auto ra = queue.try_read();
+            CHECK(ra && ra->value == 0);
+            {
+                auto moved = std::move(ra);
+                CHECK(!queue.try_emplace(4));
+            }
+            CHECK(!ra);
+            CHECK(tracked::live == 3);
+            CHECK(queue.try_emplace(4));
+        }
+        CHECK(queue.size() == 4);
+    }
+    CHECK(tracked::live == 0);
+}
+
+// The output throwing in the middle of the batch frees all taken cells.
+void throwing_pop() {
+    {
+        im::channel<tracked, 8> queue;
+        for (int i = 0; i < 5; ++i)
+            CHECK(queue.try_emplace(i));
+        std::vector<int> received;
+        bool thrown = false;
+        try {
+            queue.try_pop(throwing_output{&received, 2}, 5);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK((received == std::vector<int>{0, 1}));
+        CHECK(queue.empty());
+        CHECK(tracked::live == 0);
+        for (int i = 0; i < 8; ++i)
+            CHECK(queue.try_emplace(i));
+        CHECK(queue.try_pop()->value == 0);
+    }
+    CHECK(tracked::live == 0);
+}
+
+} // end namespace
+
+int main() {
+    boundaries();
+    batches();
+    proxies();
+    throwing_pop();
+    many_to_many();
+    return 0;
+}
@@ -0,0 +1,21 @@
+// Minimal checks of the tests, active in every build type.
+//
+
+#ifndef SMARTMUTEX_TESTS__CHECK_H_
+#define SMARTMUTEX_TESTS__CHECK_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::abort();                                                                 \
+        }                                                                                 \
+    } while (false)
+
+// Exit code making ctest report the test as skipped, see SKIP_RETURN_CODE.
+constexpr int skipped = 77;
+
+#endif //SMARTMUTEX_TESTS__CHECK_H_
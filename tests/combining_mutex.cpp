@@ -0,0 +1,96 @@
+//
+// Operations of many threads executed by the lock holder of im::combining_mutex, with
+// results and exceptions handed back to their callers.
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "combining_mutex.hpp"
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+// Thrown by the operation, carrying the id of the thread it was called by.
+struct failed
+{
+    int caller;
+};
+
+template<class Mutex>
+void combine() {
+    constexpr int threads = 8;
+    constexpr std::uint64_t operations = 20000;
+    // Every operation with the index divisible by it throws instead of incrementing.
+    constexpr std::uint64_t failing = 97;
+    // Every operation with the index divisible by it is the plain write instead.
+    constexpr std::uint64_t plain = 13;
+
+    im::smart_mutex<std::uint64_t, Mutex> counter(0);
+    std::vector<std::vector<std::uint64_t>> results(threads);
+    std::vector<std::uint64_t> thrown(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (std::uint64_t i = 1; i <= operations; ++i) {
+                if (i % plain == 0) {
+                    ++*counter.operator->().operator->();
+                    continue;
+                }
+                try {
+                    results[t].push_back(counter.combine([t, i](std::uint64_t &value) {
+                        if (i % failing == 0)
+                            throw failed{t};
+                        return ++value;
+                    }));
+                } catch (const failed &e) {
+                    // Rethrown in the caller only.
+                    CHECK(e.caller == t);
+                    ++thrown[t];
+                }
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    std::uint64_t expected_thrown = 0, expected_plain = 0;
+    for (std::uint64_t i = 1; i <= operations; ++i) {
+        if (i % plain == 0)
+            ++expected_plain;
+        else if (i % failing == 0)
+            ++expected_thrown;
+    }
+    const auto combined = operations - expected_plain - expected_thrown;
+
+    // Every caller got its own increment back, so all results are distinct.
+    std::vector<std::uint64_t> all;
+    for (int t = 0; t < threads; ++t) {
+        CHECK(thrown[t] == expected_thrown);
+        CHECK(results[t].size() == combined);
+        CHECK(std::is_sorted(results[t].begin(), results[t].end()));
+        all.insert(all.end(), results[t].begin(), results[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+
+    const auto total = *counter.operator->().operator->();
+    CHECK(total == threads * (combined + expected_plain));
+    CHECK(all.back() <= total);
+}
+
+} // end namespace
+
+int main() {
+    combine<im::combining_mutex>();
+    // One slot, so most callers find it busy and execute directly.
+    combine<im::basic_combining_mutex<std::mutex, 1>>();
+    return 0;
+}
@@ -0,0 +1,45 @@
+//
+// The value of im::indirect_smart_mutex stays in its allocation, swap, exchange and move only
+// pass the pointer.
+//
+
+#include <array>
+#include <memory>
+#include <utility>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using buffer = std::array<int, 1024>;
+
+const buffer *address(const im::indirect_smart_mutex<buffer> &smart) {
+    return std::as_const(smart).operator->().operator->();
+}
+
+} // end namespace
+
+int main() {
+    im::indirect_smart_mutex<buffer> a, b;
+    a->fill(1);
+    b->fill(2);
+    const auto *first = address(a);
+    const auto *second = address(b);
+
+    swap(a, b);
+    CHECK(address(a) == second && address(b) == first);
+    CHECK(std::as_const(a)->front() == 2 && std::as_const(b)->front() == 1);
+
+    auto replacement = std::make_unique<buffer>();
+    replacement->fill(3);
+    const auto *third = replacement.get();
+    auto previous = a.exchange(std::move(replacement));
+    CHECK(previous.get() == second && previous->front() == 2);
+    CHECK(address(a) == third && std::as_const(a)->front() == 3);
+
+    im::indirect_smart_mutex<buffer> moved(std::move(b));
+    CHECK(address(moved) == first && std::as_const(moved)->front() == 1);
+    return 0;
+}
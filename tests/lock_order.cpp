@@ -0,0 +1,81 @@
+//
+// Lock order inversions of smart_mutexes reported by SMART_MUTEX_LOCK_ORDER_CHECK.
+//
+
+#include <atomic>
+#include <functional>
+#include <utility>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+std::atomic<int> reports{0};
+
+void count_report(const im::lock_order_violation &) {
+    reports.fetch_add(1, std::memory_order_relaxed);
+}
+
+using shared_int = im::smart_mutex<int>;
+
+// Lock outer, then inner while still holding it.
+void nest(shared_int &outer, shared_int &inner) {
+    auto outer_access = outer.operator->();
+    auto inner_access = inner.operator->();
+    ++*outer_access.operator->();
+    ++*inner_access.operator->();
+}
+
+// The first and the second of two smart_mutexes in the order access_all() locks them.
+std::pair<shared_int *, shared_int *> address_order(shared_int &a, shared_int &b) {
+    if (std::less<const void *>()(&a, &b))
+        return {&a, &b};
+    return {&b, &a};
+}
+
+} // end namespace
+
+int main() {
+    im::set_lock_order_violation_handler(&count_report);
+
+    // Nesting in the same order as access_all() stays silent.
+    {
+        shared_int a, b;
+        const auto [first, second] = address_order(a, b);
+        for (int i = 0; i < 3; ++i) {
+            auto [wa, wb] = im::access_all(a, b);
+            ++*wa.operator->();
+            ++*wb.operator->();
+        }
+        nest(*first, *second);
+        nest(*first, *second);
+        CHECK(reports.load() == 0);
+    }
+
+    // The reverse nesting closes the cycle and is reported once.
+    {
+        shared_int a, b;
+        const auto [first, second] = address_order(a, b);
+        {
+            auto [wa, wb] = im::access_all(a, b);
+            ++*wa.operator->();
+            ++*wb.operator->();
+        }
+        CHECK(reports.load() == 0);
+        nest(*second, *first);
+        CHECK(reports.load() == 1);
+        nest(*second, *first);
+        CHECK(reports.load() == 1);
+    }
+
+    // Destroyed locks leave the graph, new ones in their place start clean.
+    {
+        shared_int a, b;
+        nest(a, b);
+        nest(a, b);
+        CHECK(reports.load() == 1);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+//
+// Mutual exclusion of im::numa_cohort_mutex and its bound of hand-offs within the node,
+// with the nodes of threads forced on the single node machine.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "numa_cohort_mutex.hpp"
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+using topology = im::detail::numa_topology;
+
+// Threads of different nodes increment the counter, which is not atomic.
+void exclusion() {
+    constexpr int threads = 8;
+    constexpr std::uint64_t iterations = 20000;
+    im::smart_mutex<std::uint64_t, im::basic_numa_cohort_mutex<4, 4>> counter(0);
+    std::atomic<int> inside{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            topology::force_current_node(t % 3);
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                auto wa = counter.operator->();
+                CHECK(inside.fetch_add(1, std::memory_order_relaxed) == 0);
+                ++*wa.operator->();
+                inside.fetch_sub(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    CHECK(*counter.operator->().operator->() == threads * iterations);
+}
+
+// The waiter of another node gets the lock after at most Batch holders of the owner's node.
+void handoff_bound() {
+    constexpr std::uint32_t batch = 4;
+    constexpr int local_waiters = 6;
+    im::basic_numa_cohort_mutex<batch, 2> mutex;
+    std::vector<int> owners;
+
+    topology::force_current_node(0);
+    mutex.lock();
+    std::vector<std::thread> waiters;
+    // Queued on the global lock, held by node 0.
+    waiters.emplace_back([&] {
+        topology::force_current_node(1);
+        mutex.lock();
+        owners.push_back(1);
+        mutex.unlock();
+    });
+    std::this_thread::sleep_for(20ms);
+    // Queued on the lock of node 0, behind the holder.
+    for (int t = 0; t < local_waiters; ++t) {
+        waiters.emplace_back([&] {
+            topology::force_current_node(0);
+            mutex.lock();
+            owners.push_back(0);
+            mutex.unlock();
+        });
+    }
+    std::this_thread::sleep_for(20ms);
+    mutex.unlock();
+    for (auto &waiter : waiters)
+        waiter.join();
+    topology::force_current_node(-1);
+
+    // The holder and batch - 1 local waiters, then the other node.
+    CHECK(owners.size() == local_waiters + 1);
+    std::size_t before = 0;
+    while (owners[before] == 0)
+        ++before;
+    CHECK(before == batch - 1);
+}
+
+} // end namespace
+
+int main() {
+    exclusion();
+    handoff_bound();
+    return 0;
+}
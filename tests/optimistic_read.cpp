@@ -0,0 +1,67 @@
+//
+// Readers of im::smart_mutex::optimistic_read() racing with the writer see only whole values.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+// Every write sets all words to the same number, so a torn copy has different ones.
+struct record
+{
+    std::uint64_t words[8] = {};
+};
+
+bool consistent(const record &value) {
+    for (auto word : value.words) {
+        if (word != value.words[0])
+            return false;
+    }
+    return true;
+}
+
+} // end namespace
+
+int main() {
+    constexpr int readers = 4;
+    constexpr std::uint64_t writes = 200000;
+
+    im::versioned_smart_mutex<record> shared;
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> torn{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&] {
+            std::uint64_t last = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto seen = shared.optimistic_read([&](const record &value) {
+                    if (!consistent(value))
+                        torn.fetch_add(1, std::memory_order_relaxed);
+                    return value.words[0];
+                }, 1);
+                // Versions are published in order, the reader never goes back.
+                CHECK(seen >= last);
+                last = seen;
+            }
+        });
+    }
+    for (std::uint64_t i = 1; i <= writes; ++i) {
+        auto wa = shared.operator->();
+        for (auto &word : wa->words)
+            word = i;
+    }
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads)
+        thread.join();
+
+    CHECK(torn.load() == 0);
+    CHECK(shared.optimistic_read([](const record &value) { return value.words[7]; }) == writes);
+    return 0;
+}
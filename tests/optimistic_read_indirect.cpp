@@ -0,0 +1,10 @@
+//
+// Must not compile: optimistic_read() would copy from the allocation freed by exchange().
+//
+
+#include "smart_mutex.hpp"
+
+int main() {
+    im::smart_mutex<int, std::mutex, im::layout::versioned<im::layout::indirect>> value(1);
+    return value.optimistic_read([](int current) { return current; });
+}
@@ -0,0 +1,130 @@
+//
+// Visitation of smart_mutex ranges by im::parallel_visit() on the thread per task executor,
+// with busy elements revisited and the executor failing.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parallel_visit.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+// The visit counter and the global order of the last visit.
+struct element
+{
+    int visits = 0;
+    std::size_t order = 0;
+};
+
+using elements = std::vector<im::smart_mutex<element>>;
+
+// Runs every task on its own thread, joined by the owner.
+struct thread_per_task
+{
+    void operator()(std::function<void()> task) { threads.emplace_back(std::move(task)); }
+
+    ~thread_per_task() {
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    std::vector<std::thread> threads;
+};
+
+// The busy element is skipped and visited after the rest of its chunk.
+void revisit_busy() {
+    constexpr std::size_t size = 32, busy = 1;
+    elements range(size);
+    std::atomic<std::size_t> order{0};
+    std::atomic<bool> held{false};
+
+    std::thread holder([&] {
+        auto wa = range[busy].operator->();
+        held.store(true);
+        std::this_thread::sleep_for(50ms);
+    });
+    while (!held.load())
+        std::this_thread::yield();
+
+    {
+        thread_per_task executor;
+        // 8 chunks of 4 elements, the busy one is in the first chunk.
+        im::parallel_visit(range, [&order](element &value) {
+            ++value.visits;
+            value.order = ++order;
+        }, std::ref(executor), 2);
+    }
+    holder.join();
+
+    for (auto &smart : range)
+        CHECK(std::as_const(smart)->visits == 1);
+    const auto busy_order = std::as_const(range[busy])->order;
+    for (std::size_t i = 0; i < 4; ++i)
+        CHECK(i == busy || std::as_const(range[i])->order < busy_order);
+}
+
+// The executor running the task inline and throwing afterwards.
+void executor_throws_after_running() {
+    elements range(16);
+    int calls = 0;
+    bool thrown = false;
+    try {
+        im::parallel_visit(range, [](element &value) { ++value.visits; }, [&calls](const auto &task) {
+            task();
+            if (++calls == 3)
+                throw std::runtime_error("executor failed");
+        }, 2);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    // The chunks of the three tasks which ran, two elements each.
+    int visited = 0;
+    for (auto &smart : range)
+        visited += std::as_const(smart)->visits;
+    CHECK(visited == 6);
+}
+
+// The executor queueing the tasks and throwing, the queued tasks run after the call returned.
+void executor_throws_after_queueing() {
+    std::vector<std::function<void()>> queued;
+    {
+        elements range(16);
+        bool thrown = false;
+        try {
+            im::parallel_visit(range, [](element &value) { ++value.visits; }, [&queued](auto task) {
+                queued.emplace_back(std::move(task));
+                if (queued.size() == 3)
+                    throw std::runtime_error("executor failed");
+            }, 2);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        for (auto &smart : range)
+            CHECK(std::as_const(smart)->visits == 0);
+    }
+    // The cancelled tasks don't touch the range or the function.
+    for (auto &task : queued)
+        task();
+}
+
+} // end namespace
+
+int main() {
+    revisit_busy();
+    executor_throws_after_running();
+    executor_throws_after_queueing();
+    return 0;
+}
@@ -0,0 +1,154 @@
+//
+// Priority inversion of the SCHED_FIFO waiter on im::pi_mutex held by the low priority
+// owner, while the medium priority thread keeps the only CPU busy.
+//
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <optional>
+#include <system_error>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "pi_mutex.hpp"
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+// Thread running the function with the explicit SCHED_FIFO priority.
+class fifo_thread
+{
+  public:
+    fifo_thread(int priority, std::function<void()> fn) : body(std::move(fn)) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        sched_param param{};
+        param.sched_priority = priority;
+        pthread_attr_setschedparam(&attr, &param);
+        const int error = pthread_create(&handle, &attr, &fifo_thread::run, this);
+        pthread_attr_destroy(&attr);
+        if (error != 0)
+            throw std::system_error(error, std::system_category(), "pthread_create");
+    }
+
+    ~fifo_thread() {
+        pthread_join(handle, nullptr);
+    }
+
+    fifo_thread(const fifo_thread &) = delete;
+    fifo_thread &operator=(const fifo_thread &) = delete;
+
+  private:
+    static void *run(void *self) {
+        static_cast<fifo_thread *>(self)->body();
+        return nullptr;
+    }
+
+  private:
+    // Member variables
+    std::function<void()> body;
+    pthread_t handle;
+};
+
+// CPU time consumed by the calling thread, which doesn't advance while it is preempted.
+std::chrono::nanoseconds thread_cpu_time() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+// Pin the calling thread, and the threads it creates afterwards, to one CPU it may run on.
+bool pin_to_one_cpu() {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            return sched_setaffinity(0, sizeof(one), &one) == 0;
+        }
+    }
+    return false;
+}
+
+} // end namespace
+
+int main() {
+    constexpr int low_priority = 10;
+    constexpr int medium_priority = 20;
+    constexpr int high_priority = 30;
+    constexpr int main_priority = 40;
+    constexpr auto critical_section = 50ms;
+    constexpr auto medium_busy_limit = 1000ms;
+
+    if (!pin_to_one_cpu()) {
+        std::fprintf(stderr, "couldn't pin the test to one CPU\n");
+        return skipped;
+    }
+    sched_param param{};
+    param.sched_priority = main_priority;
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error == EPERM) {
+        std::fprintf(stderr, "SCHED_FIFO requires CAP_SYS_NICE\n");
+        return skipped;
+    }
+    CHECK(error == 0);
+
+    std::optional<im::smart_mutex<int, im::pi_mutex>> shared;
+    try {
+        shared.emplace();
+    } catch (const std::system_error &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return skipped;
+    }
+
+    std::atomic<bool> locked{false};
+    std::atomic<bool> stop{false};
+    std::chrono::steady_clock::duration high_wait{};
+    {
+        // The owner needs the CPU for the whole critical section to release the lock.
+        fifo_thread low(low_priority, [&] {
+            auto wa = shared->operator->();
+            locked.store(true, std::memory_order_release);
+            const auto deadline = thread_cpu_time() + critical_section;
+            while (thread_cpu_time() < deadline)
+                ++*wa.operator->();
+        });
+        while (!locked.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(1ms);
+
+        // Without the inheritance it preempts the owner, and the high priority waiter
+        // waits for it, until the limit.
+        fifo_thread medium(medium_priority, [&] {
+            const auto deadline = std::chrono::steady_clock::now() + medium_busy_limit;
+            while (!stop.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() < deadline) {
+            }
+        });
+        fifo_thread high(high_priority, [&] {
+            const auto start = std::chrono::steady_clock::now();
+            auto wa = shared->operator->();
+            high_wait = std::chrono::steady_clock::now() - start;
+            stop.store(true, std::memory_order_relaxed);
+            ++*wa.operator->();
+        });
+    }
+
+    // The owner boosted to the waiter's priority finishes its critical section first.
+    CHECK(high_wait < medium_busy_limit / 2);
+    CHECK(*shared->operator->().operator->() > 1);
+    return 0;
+}
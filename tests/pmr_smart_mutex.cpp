@@ -0,0 +1,80 @@
+//
+// The value of im::pmr_smart_mutex keeps the allocator of its resource when it is replaced
+// by values allocated elsewhere.
+//
+
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+#include "pmr_smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+template<class Layout>
+using shared_vector = im::pmr_smart_mutex<std::pmr::vector<int>, std::mutex, std::pmr::unsynchronized_pool_resource,
+                                          Layout>;
+
+template<class Smart>
+bool uses_own_resource(Smart &smart) {
+    auto wa = smart.operator->();
+    return wa->get_allocator().resource() == &smart.resource();
+}
+
+// The copy made by the functor uses the default resource.
+template<class Layout>
+void update() {
+    shared_vector<Layout> values;
+    values->push_back(1);
+    values.update([](const std::pmr::vector<int> &current) {
+        auto copy = current;
+        copy.push_back(2);
+        return copy;
+    });
+    values.update([](const std::pmr::vector<int> &current) {
+        std::pmr::vector<int> other(current.begin(), current.end(), std::pmr::new_delete_resource());
+        other.push_back(3);
+        return other;
+    }, 0);
+    CHECK(uses_own_resource(values));
+    CHECK((*values.operator->().operator->() == std::pmr::vector<int>{1, 2, 3}));
+}
+
+template<class Layout>
+void take_all() {
+    shared_vector<Layout> values;
+    values->assign({1, 2, 3});
+
+    // The spare from another resource receives the copy of the elements.
+    std::pmr::monotonic_buffer_resource elsewhere;
+    std::pmr::vector<int> spare(&elsewhere);
+    spare.push_back(4);
+    auto &drained = values.take_all(spare);
+    CHECK((drained == std::pmr::vector<int>{1, 2, 3}));
+    CHECK(drained.get_allocator().resource() == &elsewhere);
+    CHECK(uses_own_resource(values));
+    CHECK(values->empty());
+
+    // The swap with the value of the other resource exchanges the elements.
+    std::pmr::vector<int> other({5, 6}, &elsewhere);
+    swap(values, other);
+    CHECK(other.empty());
+    CHECK(other.get_allocator().resource() == &elsewhere);
+    CHECK(uses_own_resource(values));
+    CHECK((*values.operator->().operator->() == std::pmr::vector<int>{5, 6}));
+    swap(other, values);
+    CHECK((other == std::pmr::vector<int>{5, 6}));
+    CHECK(uses_own_resource(values));
+}
+
+} // end namespace
+
+int main() {
+    update<im::layout::packed>();
+    update<im::layout::versioned<>>();
+    take_all<im::layout::packed>();
+    take_all<im::layout::versioned<>>();
+    return 0;
+}
@@ -0,0 +1,85 @@
+//
+// Events accumulated by producers in im::smart_mutex and drained by the consumer with
+// take_all() and take().
+//
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+// Two buffers are swapped on every drain, neither is reallocated.
+void recycling() {
+    im::smart_mutex<std::vector<int>> events;
+    events->reserve(64);
+    std::vector<int> spare;
+    spare.reserve(64);
+    const int *first = std::as_const(events)->data();
+    const int *second = spare.data();
+
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 10; ++i)
+            events->push_back(round * 10 + i);
+        auto &drained = events.take_all(spare);
+        CHECK(&drained == &spare);
+        CHECK(drained.size() == 10 && drained.front() == round * 10);
+        CHECK(drained.data() == (round % 2 == 0 ? first : second));
+        CHECK(std::as_const(events)->data() == (round % 2 == 0 ? second : first));
+        CHECK(std::as_const(events)->empty());
+        CHECK(std::as_const(events)->capacity() >= 64);
+    }
+
+    events->push_back(1);
+    const auto taken = events.take();
+    CHECK(taken == std::vector<int>{1});
+    CHECK(std::as_const(events)->empty());
+}
+
+// Every event is drained once, in the order of its producer.
+void producers_and_consumer() {
+    constexpr std::uint64_t producers = 4, values = 20000;
+    im::smart_mutex<std::vector<std::uint64_t>> events;
+    std::atomic<std::uint64_t> finished{0};
+    std::vector<std::thread> threads;
+    for (std::uint64_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&events, &finished, p] {
+            for (std::uint64_t i = 0; i < values; ++i)
+                events->push_back(p << 32 | i);
+            finished.fetch_add(1);
+        });
+    }
+
+    std::vector<std::uint64_t> next(producers, 0);
+    std::vector<std::uint64_t> spare;
+    std::uint64_t received = 0;
+    while (received < producers * values) {
+        const bool last = finished.load() == producers;
+        for (const auto event : events.take_all(spare)) {
+            const auto p = event >> 32;
+            CHECK(p < producers);
+            CHECK((event & 0xffffffffu) == next[p]);
+            ++next[p];
+            ++received;
+        }
+        CHECK(!last || received == producers * values);
+        std::this_thread::yield();
+    }
+    for (auto &thread : threads)
+        thread.join();
+    CHECK(std::as_const(events)->empty());
+}
+
+} // end namespace
+
+int main() {
+    recycling();
+    producers_and_consumer();
+    return 0;
+}
@@ -0,0 +1,97 @@
+//
+// update() of im::smart_mutex computing the value outside the lock, racing with writers.
+//
+
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+// The log of operations, copied by every update.
+struct journal
+{
+    std::vector<int> entries;
+    std::uint64_t updates = 0;
+    std::uint64_t writes = 0;
+};
+
+template<class Layout>
+void concurrent() {
+    constexpr int updaters = 4, writers = 2;
+    constexpr std::uint64_t iterations = 2000;
+    im::smart_mutex<journal, std::mutex, Layout> shared;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < updaters; ++t) {
+        threads.emplace_back([&shared, t] {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                shared.update([t](const journal &current) {
+                    journal next = current;
+                    next.entries.push_back(t);
+                    ++next.updates;
+                    return next;
+                });
+            }
+        });
+    }
+    for (int t = 0; t < writers; ++t) {
+        threads.emplace_back([&shared] {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                auto wa = shared.operator->();
+                wa->entries.push_back(-1);
+                ++wa->writes;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    const auto ra = std::as_const(shared).operator->();
+    CHECK(ra->updates == updaters * iterations);
+    CHECK(ra->writes == writers * iterations);
+    CHECK(ra->entries.size() == (updaters + writers) * iterations);
+}
+
+// The exception of the function leaves the value unchanged, the optimistic and the locked path.
+template<class Layout>
+void throwing() {
+    im::smart_mutex<journal, std::mutex, Layout> shared;
+    shared->entries.push_back(1);
+    for (const std::size_t attempts : {std::size_t(4), std::size_t(0)}) {
+        bool thrown = false;
+        try {
+            shared.update([](const journal &current) -> journal {
+                journal next = current;
+                next.entries.push_back(2);
+                throw std::runtime_error("failed");
+            }, attempts);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK((std::as_const(shared)->entries == std::vector<int>{1}));
+    }
+    // The lock is released and the version is consistent.
+    shared.update([](const journal &current) {
+        journal next = current;
+        next.entries.push_back(3);
+        return next;
+    });
+    CHECK((std::as_const(shared)->entries == std::vector<int>{1, 3}));
+}
+
+} // end namespace
+
+int main() {
+    concurrent<im::layout::packed>();
+    concurrent<im::layout::versioned<>>();
+    throwing<im::layout::packed>();
+    throwing<im::layout::versioned<>>();
+    return 0;
+}
@@ -0,0 +1,139 @@
+//
+// Ownership modes of im::upgrade_mutex: the upgrade lock admits readers, excludes upgraders
+// and writers, and its promotion waits for the readers to leave.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "upgrade_mutex.hpp"
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+// Transitions checked without blocking.
+void transitions() {
+    im::upgrade_mutex mutex;
+    mutex.lock_upgrade();
+    CHECK(!mutex.try_lock_upgrade());
+    CHECK(!mutex.try_lock());
+    CHECK(mutex.try_lock_shared());
+
+    // The reader keeps the upgrade lock from being promoted.
+    CHECK(!mutex.try_unlock_upgrade_and_lock());
+    CHECK(!mutex.try_lock_upgrade());
+    mutex.unlock_shared();
+    CHECK(mutex.try_unlock_upgrade_and_lock());
+    CHECK(!mutex.try_lock_shared());
+    CHECK(!mutex.try_lock_upgrade());
+
+    // Demotion lets readers in again, but not upgraders and writers.
+    mutex.unlock_and_lock_upgrade();
+    CHECK(mutex.try_lock_shared());
+    CHECK(!mutex.try_lock_upgrade());
+    CHECK(!mutex.try_lock());
+    mutex.unlock_shared();
+    mutex.unlock_upgrade();
+
+    CHECK(mutex.try_lock());
+    CHECK(!mutex.try_lock_shared());
+    CHECK(!mutex.try_lock_upgrade());
+    mutex.unlock();
+    CHECK(mutex.try_lock_upgrade());
+    mutex.unlock_upgrade();
+}
+
+// The blocked upgrader and writer get the lock only after the upgrade lock is released.
+void exclusion() {
+    im::upgrade_mutex mutex;
+    std::atomic<int> acquired{0};
+    mutex.lock_upgrade();
+    std::thread upgrader([&] {
+        mutex.lock_upgrade();
+        acquired.fetch_add(1);
+        mutex.unlock_upgrade();
+    });
+    std::thread writer([&] {
+        mutex.lock();
+        acquired.fetch_add(1);
+        mutex.unlock();
+    });
+    std::this_thread::sleep_for(20ms);
+    CHECK(acquired.load() == 0);
+    // Readers are still admitted.
+    mutex.lock_shared();
+    mutex.unlock_shared();
+    mutex.unlock_upgrade();
+    upgrader.join();
+    writer.join();
+    CHECK(acquired.load() == 2);
+}
+
+// The promotion waits for the current readers, and blocks the new ones meanwhile.
+void promotion() {
+    im::upgrade_mutex mutex;
+    std::atomic<bool> promoted{false};
+    mutex.lock_shared();
+    std::thread promoter([&] {
+        mutex.lock_upgrade();
+        mutex.unlock_upgrade_and_lock();
+        promoted.store(true);
+        std::this_thread::sleep_for(10ms);
+        mutex.unlock();
+    });
+    std::this_thread::sleep_for(20ms);
+    CHECK(!promoted.load());
+    CHECK(!mutex.try_lock_shared());
+    mutex.unlock_shared();
+    while (!promoted.load())
+        std::this_thread::yield();
+    CHECK(!mutex.try_lock_shared());
+    promoter.join();
+    CHECK(mutex.try_lock_shared());
+    mutex.unlock_shared();
+}
+
+// The read-check-then-write through upgradeable_access never loses increments.
+void read_modify_write() {
+    constexpr int threads = 6;
+    constexpr std::uint64_t iterations = 5000;
+    im::smart_mutex<std::uint64_t, im::upgrade_mutex> counter(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&counter, t] {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                if (t % 3 == 0) {
+                    const auto ra = std::as_const(counter).operator->();
+                    CHECK(*ra.operator->() <= threads * iterations);
+                    continue;
+                }
+                auto ua = counter.upgradeable();
+                const auto seen = *ua.operator->();
+                auto wa = ua.upgrade();
+                CHECK(*wa.operator->() == seen);
+                *wa.operator->() = seen + 1;
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    CHECK(*counter.operator->().operator->() == (threads - threads / 3) * iterations);
+}
+
+} // end namespace
+
+int main() {
+    transitions();
+    exclusion();
+    promotion();
+    read_modify_write();
+    return 0;
+}
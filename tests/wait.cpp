@@ -0,0 +1,129 @@
+//
+// Threads blocked in wait_write() and wait_read() of im::waitable_smart_mutex are woken up
+// only by the writes satisfying their predicates.
+//
+
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "smart_mutex.hpp"
+#include "check.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+// Block until the flag is set, the waiter sets it from its predicate before enqueueing.
+void wait_for(const std::atomic<bool> &flag) {
+    while (!flag.load(std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+// Every thread waits for its turn and passes it to the next one.
+void relay() {
+    constexpr int threads = 8;
+    im::waitable_smart_mutex<int> turn(0);
+    std::vector<std::thread> workers;
+    for (int t = threads - 1; t >= 0; --t) {
+        workers.emplace_back([&turn, t] {
+            auto wa = turn.wait_write([t](int value) { return value == t; });
+            ++*wa.operator->();
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    CHECK(*turn.operator->().operator->() == threads);
+}
+
+// Readers of SharedLockable Mutex wait holding the shared lock and are all woken up.
+void readers() {
+    constexpr int threads = 4;
+    im::waitable_smart_mutex<int, std::shared_mutex> level(0);
+    std::atomic<int> passed{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            auto ra = level.wait_read([](int value) { return value > 0; });
+            CHECK(*ra.operator->() > 0);
+            passed.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    std::this_thread::sleep_for(10ms);
+    *level.operator->().operator->() = 1;
+    for (auto &worker : workers)
+        worker.join();
+    CHECK(passed.load() == threads);
+}
+
+// The waiter isn't woken up by the writes which don't satisfy its predicate.
+void targeted() {
+    constexpr int writes = 100;
+    im::waitable_smart_mutex<int> value(0);
+    std::atomic<bool> waiting{false};
+    int own_checks = 0;
+    std::thread waiter([&] {
+        const auto self = std::this_thread::get_id();
+        auto wa = value.wait_write([&](int current) {
+            if (std::this_thread::get_id() == self) {
+                ++own_checks;
+                waiting.store(true, std::memory_order_release);
+            }
+            return current == writes;
+        });
+        CHECK(*wa.operator->() == writes);
+    });
+    wait_for(waiting);
+    for (int i = 1; i <= writes; ++i)
+        *value.operator->().operator->() = i;
+    waiter.join();
+    // The check before blocking and the one after the wakeup.
+    CHECK(own_checks == 2);
+}
+
+// The waiter leaving on timeout is removed from the list.
+void timeout() {
+    im::waitable_smart_mutex<int> value(0);
+    auto wa = value.wait_write_for(5ms, [](int current) { return current != 0; });
+    CHECK(!wa);
+    *value.operator->().operator->() = 1;
+    CHECK(value.wait_write_for(5ms, [](int current) { return current != 0; }));
+}
+
+// The predicate throwing in the writer's thread is rethrown by the waiter.
+void throwing() {
+    im::waitable_smart_mutex<int> value(0);
+    std::atomic<bool> waiting{false};
+    bool thrown = false;
+    std::thread waiter([&] {
+        try {
+            value.wait_write([&](int current) {
+                waiting.store(true, std::memory_order_release);
+                if (current == 2)
+                    throw std::runtime_error("unexpected value");
+                return false;
+            });
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+    });
+    wait_for(waiting);
+    *value.operator->().operator->() = 2;
+    waiter.join();
+    CHECK(thrown);
+}
+
+} // end namespace
+
+int main() {
+    relay();
+    readers();
+    targeted();
+    timeout();
+    throwing();
+    return 0;
+}